@@ -0,0 +1,71 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// process wide storage of the arena chunks: the lists of the world may
+// unlink its handlers on the thread exit after the arena is destroyed
+struct ArenaChunks
+{
+    char* allocate(size_t size)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        chunks.emplace_back(new char[size]);
+        return chunks.back().get();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<char[]>> chunks;
+};
+
+/*
+ * Per world arena of the handlers: the handler is allocated by bumping
+ * the offset and it is never freed one by one. The emulator drops all
+ * handlers on init and restore, then the arena is reset in O(1) and
+ * the chunks are reused by the next iteration.
+ */
+struct Arena
+{
+    static constexpr size_t chunkSize = 64 * 1024;
+
+    void* allocate(size_t size)
+    {
+        const size_t align = alignof(std::max_align_t);
+        size = (size + align - 1) / align * align;
+        VERIFY(size <= chunkSize, "Arena block is too large");
+        if (used == 0 || offset + size > chunkSize)
+        {
+            if (used == chunks.size())
+                chunks.push_back(shared<ArenaChunks>().allocate(chunkSize));
+            ++ used;
+            offset = 0;
+        }
+        void* p = chunks[used - 1] + offset;
+        offset += size;
+        return p;
+    }
+
+    void reset()
+    {
+        used = 0;
+        offset = 0;
+    }
+
+private:
+    std::vector<char*> chunks;
+    size_t used = 0;
+    size_t offset = 0;
+};
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+inline size_t bitIndex(int i)
+{
+    return i;
+}
+
+/*
+ * Set of the small values with the std::set interface used by services:
+ * the element is the bit of bitIndex() thus the set algebra is a word op.
+ * Elements are enumerated in the ascending order like std::set does.
+ */
+template<typename T>
+struct BitSet
+{
+    struct Iterator
+    {
+        T operator*() const                     { return T(lowest(bits)); }
+        Iterator& operator++()                  { bits &= bits - 1; return *this; }
+        bool operator==(const Iterator& i) const { return bits == i.bits; }
+        bool operator!=(const Iterator& i) const { return bits != i.bits; }
+        
+        uint64_t bits;
+    };
+    
+    using value_type = T;
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+    
+    BitSet() = default;
+    
+    BitSet(std::initializer_list<T> values)
+    {
+        for (auto&& t: values)
+            insert(t);
+    }
+    
+    void insert(const T& t)     { bits |= bit(t); }
+    size_t erase(const T& t)    { size_t c = count(t); bits &= ~bit(t); return c; }
+    void clear()                { bits = 0; }
+    size_t count(const T& t) const  { return (bits & bit(t)) != 0; }
+    size_t size() const         { return std::bitset<64>(bits).count(); }
+    bool empty() const          { return bits == 0; }
+    Iterator begin() const      { return {bits}; }
+    Iterator end() const        { return {0}; }
+    
+    size_t hash() const
+    {
+        return hashOf(bits);
+    }
+    
+    bool operator==(const BitSet& s) const  { return bits == s.bits; }
+    bool operator!=(const BitSet& s) const  { return bits != s.bits; }
+    
+    BitSet& operator|=(const T& t)          { insert(t); return *this; }
+    BitSet& operator|=(const BitSet& s)     { bits |= s.bits; return *this; }
+    BitSet& operator&=(const BitSet& s)     { bits &= s.bits; return *this; }
+    
+    friend BitSet operator|(BitSet s1, const BitSet& s2)    { return s1 |= s2; }
+    friend BitSet operator&(BitSet s1, const BitSet& s2)    { return s1 &= s2; }
+    friend BitSet operator-(BitSet s1, const BitSet& s2)    { s1.bits &= ~s2.bits; return s1; }
+    friend BitSet operator-(BitSet s1, const T& t)          { s1.erase(t); return s1; }
+    
+private:
+    static uint64_t bit(const T& t)
+    {
+        size_t i = bitIndex(t);
+        VERIFY(i < 64, "Bit set value is out of range");
+        return uint64_t(1) << i;
+    }
+    
+    static int lowest(uint64_t bits)
+    {
+        return std::bitset<64>((bits & (~bits + 1)) - 1).count();
+    }
+    
+    uint64_t bits = 0;
+};
+
+template<typename T>
+std::ostream& operator<<(std::ostream& o, const BitSet<T>& s)
+{
+    return outStream(o, s);
+}
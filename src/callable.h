@@ -0,0 +1,217 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// fits the trigger capturing the shared message payload and the disconnection
+#ifndef HANDLER_BUFFER_SIZE
+#   define HANDLER_BUFFER_SIZE     64
+#endif
+
+/*
+ * Move only type erased callable: the callable is stored inline
+ * if it fits the buffer, otherwise it is allocated on the heap.
+ * The copy is explicit by clone() e.g. to save the handler into the snapshot.
+ */
+template<size_t N>
+struct Callable
+{
+    Callable() = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Callable>::value>>
+    Callable(F&& f)
+    {
+        using T = std::decay_t<F>;
+        construct<T>(Inline<T>(), std::forward<F>(f));
+        ops = &opsOf<T>();
+    }
+
+    Callable(Callable&& c) noexcept
+    {
+        moveFrom(c);
+    }
+
+    Callable& operator=(Callable&& c) noexcept
+    {
+        if (this != &c)
+        {
+            reset();
+            moveFrom(c);
+        }
+        return *this;
+    }
+
+    Callable(const Callable&) = delete;
+    Callable& operator=(const Callable&) = delete;
+
+    ~Callable()
+    {
+        reset();
+    }
+
+    Callable clone() const
+    {
+        Callable c;
+        if (ops != nullptr)
+        {
+            ops->clone(*this, c);
+            c.ops = ops;
+        }
+        return c;
+    }
+
+    void operator()()
+    {
+        VERIFY(ops != nullptr, "Callable is empty");
+        ops->call(*this);
+    }
+
+    explicit operator bool() const
+    {
+        return ops != nullptr;
+    }
+
+private:
+    struct Ops
+    {
+        void (*call)(Callable&);
+        void (*move)(Callable& from, Callable& to);
+        void (*clone)(const Callable& from, Callable& to);
+        void (*destroy)(Callable&);
+    };
+
+    template<typename T>
+    using Inline = std::integral_constant<bool,
+        sizeof(T) <= N && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<T>::value>;
+
+    template<typename T, typename... T_args>
+    void construct(std::true_type, T_args&&... args)
+    {
+        new (&buffer) T(std::forward<T_args>(args)...);
+    }
+
+    template<typename T, typename... T_args>
+    void construct(std::false_type, T_args&&... args)
+    {
+        heap() = new T(std::forward<T_args>(args)...);
+    }
+
+    template<typename T>
+    static T& get(Callable& c, std::true_type)
+    {
+        return reinterpret_cast<T&>(c.buffer);
+    }
+
+    template<typename T>
+    static T& get(Callable& c, std::false_type)
+    {
+        return *static_cast<T*>(c.heap());
+    }
+
+    template<typename T>
+    static T& get(Callable& c)
+    {
+        return get<T>(c, Inline<T>());
+    }
+
+    template<typename T>
+    static const T& get(const Callable& c)
+    {
+        return get<T>(const_cast<Callable&>(c));
+    }
+
+    template<typename T>
+    static const Ops& opsOf()
+    {
+        static const Ops o = {
+            [](Callable& c) { get<T>(c)(); },
+            [](Callable& from, Callable& to) {
+                moveTo<T>(from, to, Inline<T>());
+            },
+            [](const Callable& from, Callable& to) {
+                cloneTo<T>(from, to, std::is_copy_constructible<T>());
+            },
+            [](Callable& c) {
+                T& t = get<T>(c);
+                if (Inline<T>::value)
+                    t.~T();
+                else
+                    delete &t;
+            },
+        };
+        return o;
+    }
+
+    template<typename T>
+    static void moveTo(Callable& from, Callable& to, std::true_type)
+    {
+        to.construct<T>(std::true_type(), std::move(get<T>(from)));
+        get<T>(from).~T();
+    }
+
+    template<typename T>
+    static void moveTo(Callable& from, Callable& to, std::false_type)
+    {
+        to.heap() = from.heap();
+    }
+
+    template<typename T>
+    static void cloneTo(const Callable& from, Callable& to, std::true_type)
+    {
+        to.construct<T>(Inline<T>(), get<T>(from));
+    }
+
+    template<typename T>
+    static void cloneTo(const Callable&, Callable&, std::false_type)
+    {
+        RAISE("Callable cannot be cloned: " + getTypeName<T>());
+    }
+
+    void moveFrom(Callable& c)
+    {
+        if (c.ops != nullptr)
+        {
+            c.ops->move(c, *this);
+            ops = c.ops;
+            c.ops = nullptr;
+        }
+    }
+
+    void reset()
+    {
+        if (ops != nullptr)
+        {
+            ops->destroy(*this);
+            ops = nullptr;
+        }
+    }
+
+    void*& heap()
+    {
+        return reinterpret_cast<void*&>(buffer);
+    }
+
+    void* heap() const
+    {
+        return reinterpret_cast<void* const&>(buffer);
+    }
+
+    using Buffer = std::aligned_storage_t<(N < sizeof(void*) ? sizeof(void*) : N), alignof(std::max_align_t)>;
+
+    Buffer buffer;
+    const Ops* ops = nullptr;
+};
+
+// callable of the handler queued to the node
+using HandlerCall = Callable<HANDLER_BUFFER_SIZE>;
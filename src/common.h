@@ -67,8 +67,17 @@ struct IObject
     virtual ~IObject() {}
 };
 
+// every worker thread owns its own instance: nodes, queues, emulator etc
 template<typename T, typename T_tag = T>
 T& single()
+{
+    static thread_local T t;
+    return t;
+}
+
+// the instance is shared among all worker threads
+template<typename T, typename T_tag = T>
+T& shared()
 {
     static T t;
     return t;
@@ -111,3 +120,12 @@ struct An
     const T* operator->() const { return &single<T>(); }
 };
 
+template<typename T>
+struct Shared
+{
+    T& operator*()              { return shared<T>(); }
+    const T& operator*() const  { return shared<T>(); }
+    T* operator->()             { return &shared<T>(); }
+    const T* operator->() const { return &shared<T>(); }
+};
+
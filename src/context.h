@@ -32,6 +32,18 @@ inline Context& context()
     return single<Context>();
 }
 
+// unique ids of the world, restarted on each iteration
+// thus the same states of different iterations are equal
+struct Ids : Initer<Ids>
+{
+    int last = 0;
+
+    int next()
+    {
+        return ++ last;
+    }
+};
+
 inline Context destinationContext(int dst)
 {
     return {context().currentNode, dst};
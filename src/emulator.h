@@ -16,6 +16,14 @@
 
 #define ELOG(D_msg)         JLOG("EMUL: " << D_msg)
 
+// order of the variants explored by the scheduler
+enum class Frontier
+{
+    Depth,      // depth-first
+    Breadth,    // level by level: the next level is kept without snapshots
+    Deepening,  // depth-first bounded by the depth raised level by level
+};
+
 struct Config
 {
     int nodes = 3;
@@ -25,6 +33,33 @@ struct Config
     int progressIterations = 10000;
     int maxSteps = 50;
     int minUnreliableNode = 1;
+    int threads = 1;
+    bool snapshots = true;
+    bool sleepSets = false;
+    int64_t visitedStates = 0; // size of the visited states table, 0: stateless
+    int64_t bitstateBits = 0; // size of the bitstate table in bits, 0: exact visited states table
+    int bitstateHashes = 3; // bits per state in the bitstate table
+    std::vector<int> symmetricNodes; // interchangeable nodes for the stateful mode
+    int64_t spillVariants = 0; // pending variants per worker kept in memory, 0: no spilling to disk
+    uint64_t seed = 0; // seed of the random walks
+    double maxSeconds = 0; // time bound of the random walks, 0: unbounded
+    bool swarm = false; // random walks choose the failing nodes randomly
+    int maxBound = 0; // max preemptions and faults explored by BoundedScheduler, 0: all variants
+    Frontier frontier = Frontier::Depth;
+    bool minimize = false; // failed variants are minimized before they are shown
+    std::string algorithm; // name of the verified algorithm recorded to the traces
+    std::string traceFile; // failed variants are appended to the file, empty: no traces
+    int levelSteps = 1; // steps added by each level of the breadth and deepening frontiers
+
+    bool stateful() const
+    {
+        return visitedStates != 0 || bitstateBits != 0;
+    }
+
+    bool symmetric() const
+    {
+        return stateful() && !symmetricNodes.empty();
+    }
 };
 
 struct Nodes
@@ -88,56 +123,156 @@ struct Nodes
             n.shutdownProcesses();
     }
     
+    size_t hash() const
+    {
+        return hashByNode(nodes);
+    }
+    
+    std::vector<NodeState> save() const
+    {
+        std::vector<NodeState> states;
+        for (const Node& n: nodes)
+            states.push_back(n.save());
+        return states;
+    }
+    
+    void restore(const std::vector<NodeState>& states)
+    {
+        VERIFY(states.size() == nodes.size(), "Invalid nodes state");
+        queues->clear();
+        for (size_t i = 0; i < nodes.size(); ++ i)
+            nodes[i].restore(states[i]);
+    }
+    
 private:
     std::vector<Node> nodes;
     An<Stats> stats;
-    An<GlobalStats> globalStats;
+    Shared<GlobalStats> globalStats;
     An<Config> config;
+    An<Queues> queues;
 };
 
 template<typename T_service, typename T_msg>
-std::string triggerName(const Context& ctx = context())
+size_t triggerHash(const Context& ctx, const T_msg& msg)
 {
-    return getTypeName<T_service>() + "::" + getTypeName<T_msg>()
-            + " " + std::to_string(ctx.sourceNode) + "=>" + std::to_string(ctx.currentNode);
+    return hashOf(getType<T_service>().hash_code(), getType<T_msg>().hash_code(),
+                  hashNode(ctx.sourceNode), hashNode(ctx.currentNode), msg);
 }
 
-inline std::string disconnectionName(int dstNode)
+// pending disconnections in the node order, the invoked one leaves the range
+using Disconnects = std::vector<NodeHandler*>;
+
+/*
+ * Allocation free view of the enabled handlers: the fronts of the nonempty
+ * queues in the registration order followed by the pending disconnections.
+ * The view is valid until the next handler is invoked.
+ */
+struct Available
 {
-    return "node disconnection: " + std::to_string(dstNode);
+    struct Iterator
+    {
+        NodeHandler* operator*() const  { return (*available)[index]; }
+        Iterator& operator++()          { ++ index; return *this; }
+        bool operator!=(const Iterator& i) const { return index != i.index; }
+        
+        const Available* available;
+        size_t index;
+    };
+    
+    Available(const Queues& q, const Disconnects& d)
+        : queues(q), disconnects(d), queuesCount(q.enabledCount())
+    {
+    }
+    
+    size_t size() const
+    {
+        return queuesCount + disconnects.size();
+    }
+    
+    bool empty() const
+    {
+        return size() == 0;
+    }
+    
+    NodeHandler* operator[](size_t i) const
+    {
+        if (i < queuesCount)
+            return &queues.enabled(i).front();
+        return disconnects[i - queuesCount];
+    }
+    
+    NodeHandler* at(size_t i) const
+    {
+        VERIFY(i < size(), "Invalid available handler index");
+        return (*this)[i];
+    }
+    
+    NodeHandler* front() const
+    {
+        return at(0);
+    }
+    
+    Iterator begin() const  { return {this, 0}; }
+    Iterator end() const    { return {this, size()}; }
+    
+private:
+    const Queues& queues;
+    const Disconnects& disconnects;
+    size_t queuesCount;
+};
+
+// immutable message shared among the handlers e.g. of the broadcast
+template<typename T_msg>
+using Payload = std::shared_ptr<const T_msg>;
+
+template<typename T_msg>
+Payload<std::decay_t<T_msg>> payload(T_msg&& msg)
+{
+    return std::make_shared<const std::decay_t<T_msg>>(std::forward<T_msg>(msg));
 }
 
 struct Emulator
 {
+    // the message is moved into the payload if possible
+    template<typename T_service, typename T_msg>
+    bool trigger(int dstNode, T_msg&& msg)
+    {
+        if (!nodes->node(dstNode).hasProcess<T_service>())
+            return false;
+        return triggerPayload<T_service>(dstNode, payload(std::forward<T_msg>(msg)));
+    }
+    
     template<typename T_service, typename T_msg>
-    bool trigger(int dstNode, const T_msg& msg)
+    bool triggerPayload(int dstNode, const Payload<T_msg>& msg)
     {
         if (!nodes->node(dstNode).hasProcess<T_service>())
             return false;
         Context ctx = destinationContext(dstNode);
+        std::function<size_t()> hasher;
+        size_t hash = 0;
+        if (config->symmetric())
+            hasher = [ctx, msg] { return triggerHash<T_service>(ctx, *msg); };
+        else if (config->stateful())
+            hash = triggerHash<T_service>(ctx, *msg);
         auto& handler = NodeHandler::create(
             [this, ctx, dstNode, msg] {
                 context() = ctx;
-                nodes->node(dstNode).getProcess<T_service>().on(msg);
+                nodes->node(dstNode).getProcess<T_service>().on(*msg);
             },
             triggerName<T_service, T_msg>(ctx),
             EventType::Trigger
         );
+        handler.context = ctx;
+        handler.creator = stats->steps;
+        handler.hash = hash;
+        handler.hasher = std::move(hasher);
         nodes->node(dstNode).getProcess<T_service>().push(handler);
         return true;
     }
     
-    std::vector<NodeHandler*> available()
+    Available available()
     {
-        std::vector<NodeHandler*> result;
-        for (IHandlerQueue& q: *queues)
-        {
-            if (!q.empty())
-                result.push_back(&q.front());
-        }
-        for (NodeHandler& h: nodeDisconnects)
-            result.push_back(&h);
-        return result;
+        return {*queues, nodeDisconnects};
     }
     
     void printAvailable()
@@ -151,36 +286,119 @@ struct Emulator
     
     void init()
     {
-        // clear all handler queues (process may be excluded on shutdown)
-        queues->clear();
-        nodes->shutdown();
+        dropHandlers();
+        ids->init();
         nodes->init();
         initDisconnections();
         printAvailable();
     }
     
+    Snapshot save()
+    {
+        Snapshot s;
+        s.nodes = nodes->save();
+        for (NodeHandler* h: nodeDisconnects)
+            s.disconnects.push_back(*h);
+        s.stats = *stats;
+        s.context = context();
+        s.ids = *ids;
+        return s;
+    }
+    
+    void restore(const Snapshot& s)
+    {
+        VERIFY(s.isLocal(), "Snapshot belongs to another world");
+        dropHandlers();
+        nodes->restore(s.nodes);
+        for (auto&& h: s.disconnects)
+            nodeDisconnects.push_back(&NodeHandler::create(h));
+        *stats = s.stats;
+        context() = s.context;
+        *ids = s.ids;
+    }
+    
+    // fingerprint of the global state: services, pending messages and disconnects,
+    // the minimal one among the permutations of the symmetric nodes
+    size_t hash()
+    {
+        if (!config->symmetric())
+            return stateHash();
+        if (symmetricNodes != config->symmetricNodes)
+        {
+            symmetricNodes = config->symmetricNodes;
+            symmetries = permutations(symmetricNodes);
+        }
+        size_t h = std::numeric_limits<size_t>::max();
+        for (auto&& p: symmetries)
+        {
+            permutation() = p;
+            h = std::min(h, stateHash());
+        }
+        permutation() = {};
+        return h;
+    }
+    
 private:
+    // no handler is alive thus the arena memory is reused
+    void dropHandlers()
+    {
+        // clear all handler queues (process may be excluded on shutdown)
+        queues->clear();
+        nodes->shutdown();
+        nodeDisconnects.clear();
+        handlers->clearDispose(); // disconnections and e.g. the handler left by the exception
+        arena->reset();
+    }
+    
     void initDisconnections()
     {
-        nodeDisconnects.clearDispose();
         VERIFY(nodeDisconnects.empty(), "handler disconnects clear failed");
         for (size_t dstNode = config->minUnreliableNode; dstNode < nodes->size(); ++ dstNode)
         {
             auto& handler = NodeHandler::create(
                 [this, dstNode] {
+                    removeDisconnection(dstNode);
                     nodes->disconnect(dstNode);
                 },
                 disconnectionName(dstNode),
                 EventType::Disconnect
             );
-            nodeDisconnects.push_back(handler);
+            handler.context = {-1, int(dstNode)};
+            nodeDisconnects.push_back(&handler);
         }
     }
+    
+    // the invoked disconnection is deleted after the call
+    void removeDisconnection(size_t dstNode)
+    {
+        auto it = std::find_if(nodeDisconnects.begin(), nodeDisconnects.end(), [dstNode](const NodeHandler* h) {
+            return h->context.currentNode == int(dstNode);
+        });
+        VERIFY(it != nodeDisconnects.end(), "Invoked disconnection must be pending");
+        nodeDisconnects.erase(it);
+    }
+
+    size_t stateHash()
+    {
+        size_t h = nodes->hash();
+        std::vector<int> disconnects;
+        for (const NodeHandler* d: nodeDisconnects)
+            disconnects.push_back(d->context.currentNode);
+        hashCombine(h, hashNodes(disconnects));
+        hashCombine(h, stats->disconnects);
+        return h;
+    }
 
     An<Nodes> nodes;
     An<Queues> queues;
+    An<Stats> stats;
+    An<Ids> ids;
     An<Config> config;
+    An<Handlers> handlers;
+    An<Arena> arena;
     
-    List<NodeHandler, &NodeHandler::queue> nodeDisconnects;
+    Disconnects nodeDisconnects;
+    std::vector<int> symmetricNodes;
+    std::vector<Permutation> symmetries;
 };
 
@@ -43,23 +43,82 @@ inline std::ostream& operator<<(std::ostream& o, EventType type)
     return o << toString(type);
 }
 
+/*
+ * Handler description: the interned type names and the nodes,
+ * the string is formatted only when the log needs it.
+ */
+struct HandlerName
+{
+    const std::string* service = nullptr; // nullptr: node disconnection
+    const std::string* message = nullptr;
+    Context context;
+};
+
+template<typename T_service, typename T_msg>
+HandlerName triggerName(const Context& ctx = context())
+{
+    return {&getTypeName<T_service>(), &getTypeName<T_msg>(), ctx};
+}
+
+inline HandlerName disconnectionName(int dstNode)
+{
+    return {nullptr, nullptr, {-1, dstNode}};
+}
+
+// the same handler across the replays of different variants
+inline bool operator==(const HandlerName& l, const HandlerName& r)
+{
+    return l.service == r.service && l.message == r.message &&
+        l.context.sourceNode == r.context.sourceNode && l.context.currentNode == r.context.currentNode;
+}
+
+inline bool operator!=(const HandlerName& l, const HandlerName& r)
+{
+    return !(l == r);
+}
+
+inline std::ostream& operator<<(std::ostream& o, const HandlerName& name)
+{
+    if (name.service == nullptr)
+        return o << "node disconnection: " << name.context.currentNode;
+    return o << *name.service << "::" << *name.message
+             << " " << name.context.sourceNode << "=>" << name.context.currentNode;
+}
+
 struct NodeHandler;
+struct IHandlerQueue;
 
 inline void attach(NodeHandler& h);
+inline void dequeued(IHandlerQueue& q);
 
-struct NodeHandler : Handler
+struct NodeHandler : HandlerCall
 {
-    using Handler::Handler;
-    
-    // FIX: workaround GCC 4.9
-    NodeHandler(Handler&& h) : Handler(std::move(h)) {}
+    NodeHandler(HandlerCall&& h) : HandlerCall(std::move(h)) {}
+
+    // clones the callable, the copy is not linked to any list
+    NodeHandler(const NodeHandler& h)
+        : HandlerCall(h.clone()), name(h.name), type(h.type), id(h.id), context(h.context),
+          creator(h.creator), hash(h.hash), hasher(h.hasher)
+    {
+    }
 
-    std::string name;
+    HandlerName name;
     EventType type;
+    int64_t id = 0;       // creation number: the same across replays of the variant
+    Context context;      // source and destination nodes
+    int64_t creator = 0;  // step number the handler is created on, 0: on init
+    size_t hash = 0;      // used by stateful exploration only
+    std::function<size_t()> hasher; // hash under the current permutation, symmetric mode only
+
+    size_t stateHash() const
+    {
+        return hasher ? hasher() : hash;
+    }
     
     // container section
     ListHook queue; // list of scheduled handlers
     ListHook all;   // list of all handlers
+    IHandlerQueue* owner = nullptr; // queue the handler is scheduled in
     
     void dump()
     {
@@ -71,22 +130,46 @@ struct NodeHandler : Handler
         RLOG("invoking: " << name << " [" << type << "]");
     }
 
+    // handlers live in the arena of the world till the emulator drops them
+    static void* operator new(size_t size)
+    {
+        return An<Arena>()->allocate(size);
+    }
+
+    static void operator delete(void*)
+    {
+    }
+
     void invoke()
     {
         dump();
+        ++ An<Stats>()->steps;
         (*this)();
+        IHandlerQueue* q = owner;
         delete this;
+        if (q != nullptr)
+            dequeued(*q);
     }
     
-    static NodeHandler& create(Handler handler, std::string name, EventType type)
+    static NodeHandler& create(HandlerCall handler, HandlerName name, EventType type)
     {
         HLOG("creating: " << name);
         auto* h = new NodeHandler(std::move(handler));
         attach(*h);
-        h->name = std::move(name);
+        h->id = ++ An<Stats>()->handlers;
+        h->name = name;
         h->type = type;
         return *h;
     }
+
+    // copy is not linked to any list
+    static NodeHandler& create(const NodeHandler& handler)
+    {
+        HLOG("cloning: " << handler.name);
+        auto* h = new NodeHandler(handler);
+        attach(*h);
+        return *h;
+    }
 };
 
 using Handlers = List<NodeHandler, &NodeHandler::all>;
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * State hashing: the type may provide the member function
+ *     size_t hash() const;
+ * otherwise arithmetic, enum and empty types are hashed by value
+ * and standard containers by their elements.
+ */
+
+inline size_t hashMix(uint64_t h)
+{
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+inline void hashCombine(size_t& seed, size_t h)
+{
+    seed = hashMix(seed + 0x9e3779b97f4a7c15ULL + h);
+}
+
+template<typename T>
+struct HasHash
+{
+    template<typename U>
+    static auto check(int) -> decltype(std::declval<const U&>().hash(), std::true_type{});
+
+    template<typename U>
+    static std::false_type check(...);
+
+    static constexpr bool value = decltype(check<T>(0))::value;
+};
+
+template<typename T>
+size_t hashOf(const T& t);
+
+template<typename T>
+size_t hashOf(const std::vector<T>& v);
+
+template<typename T>
+size_t hashOf(const std::set<T>& s);
+
+template<typename K, typename V, typename H>
+size_t hashOf(const std::unordered_map<K, V, H>& m);
+
+template<typename T, typename U>
+size_t hashOf(const std::pair<T, U>& p)
+{
+    size_t h = hashOf(p.first);
+    hashCombine(h, hashOf(p.second));
+    return h;
+}
+
+template<typename T1, typename T2, typename... T>
+size_t hashOf(const T1& t1, const T2& t2, const T&... t)
+{
+    size_t h = hashOf(t1);
+    hashCombine(h, hashOf(t2, t...));
+    return h;
+}
+
+template<typename T_iterable>
+size_t hashRange(const T_iterable& it)
+{
+    size_t h = 0;
+    for (auto&& t: it)
+        hashCombine(h, hashOf(t));
+    return h;
+}
+
+template<typename T>
+size_t hashOf(const std::vector<T>& v)
+{
+    return hashRange(v);
+}
+
+template<typename T>
+size_t hashOf(const std::set<T>& s)
+{
+    return hashRange(s);
+}
+
+// order independent
+template<typename K, typename V, typename H>
+size_t hashOf(const std::unordered_map<K, V, H>& m)
+{
+    size_t h = m.size();
+    for (auto&& kv: m)
+        h += hashMix(hashOf(kv));
+    return h;
+}
+
+inline size_t hashOf(const std::string& s)
+{
+    return std::hash<std::string>()(s);
+}
+
+template<typename T, typename std::enable_if<HasHash<T>::value, int>::type = 0>
+size_t hashValue(const T& t)
+{
+    return t.hash();
+}
+
+template<typename T, typename std::enable_if<!HasHash<T>::value && std::is_enum<T>::value, int>::type = 0>
+size_t hashValue(const T& t)
+{
+    return hashMix(size_t(t));
+}
+
+template<typename T, typename std::enable_if<!HasHash<T>::value && std::is_arithmetic<T>::value, int>::type = 0>
+size_t hashValue(const T& t)
+{
+    return hashMix(std::hash<T>()(t));
+}
+
+template<typename T, typename std::enable_if<!HasHash<T>::value && std::is_empty<T>::value, int>::type = 0>
+size_t hashValue(const T&)
+{
+    return 0;
+}
+
+template<typename T, typename std::enable_if<!HasHash<T>::value && !std::is_enum<T>::value
+    && !std::is_arithmetic<T>::value && !std::is_empty<T>::value, int>::type = 0>
+size_t hashValue(const T&)
+{
+    RAISE("Type must provide hash for stateful exploration: " + getTypeName<T>());
+}
+
+template<typename T>
+size_t hashOf(const T& t)
+{
+    return hashValue(t);
+}
+
+/*
+ * Node symmetry: the state is hashed under each permutation of the
+ * interchangeable nodes. Thus services and messages must hash node ids
+ * using hashNode() and containers of nodes using hashNodes() or hashByNode().
+ */
+struct Permutation
+{
+    std::vector<int> nodes; // empty: identity
+
+    int operator()(int node) const
+    {
+        return node >= 0 && node < int(nodes.size()) ? nodes[node] : node;
+    }
+};
+
+// current permutation used by the hashing
+inline Permutation& permutation()
+{
+    return single<Permutation>();
+}
+
+inline size_t hashNode(int node)
+{
+    return hashMix(permutation()(node) + 1);
+}
+
+// order independent
+template<typename T_nodes>
+size_t hashNodes(const T_nodes& nodes)
+{
+    size_t h = 0;
+    for (int node: nodes)
+        h += hashMix(hashNode(node));
+    return h;
+}
+
+// i-th element belongs to the node i
+template<typename T>
+size_t hashByNode(const std::vector<T>& v)
+{
+    size_t h = v.size();
+    for (size_t i = 0; i < v.size(); ++ i)
+        h += hashMix(hashOf(hashNode(i), hashOf(v[i])));
+    return h;
+}
+
+// all permutations of the interchangeable nodes including identity
+inline std::vector<Permutation> permutations(std::vector<int> symmetric)
+{
+    std::vector<Permutation> result;
+    if (symmetric.empty())
+        return result;
+    std::sort(symmetric.begin(), symmetric.end());
+    std::vector<int> permuted = symmetric;
+    do
+    {
+        Permutation p;
+        p.nodes.resize(symmetric.back() + 1);
+        for (size_t i = 0; i < p.nodes.size(); ++ i)
+            p.nodes[i] = i;
+        for (size_t i = 0; i < symmetric.size(); ++ i)
+            p.nodes[symmetric[i]] = permuted[i];
+        result.push_back(std::move(p));
+    } while (std::next_permutation(permuted.begin(), permuted.end()));
+    return result;
+}
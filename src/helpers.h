@@ -31,7 +31,7 @@
 // Release log
 #ifdef flagLOG_MUTEX
 #   include <mutex>
-#   define RLOG(D_msg)              do { std::lock_guard<std::mutex> _(single<std::mutex>()); SLOG__(D_msg); } while(false)
+#   define RLOG(D_msg)              do { std::lock_guard<std::mutex> _(shared<std::mutex>()); SLOG__(D_msg); } while(false)
 #else
 #   define RLOG                     SLOG__
 #endif
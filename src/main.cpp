@@ -23,6 +23,7 @@ void testReplobCalm(int clientCommits);
 void testReplobFlat(int clientCommits);
 void testReplobMost(int clientCommits);
 void testReplobRush(int clientCommits);
+void testReplobRushDelta(int clientCommits);
 
 int main(/*int argc, char* argv[]*/)
 {
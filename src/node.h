@@ -22,6 +22,9 @@ struct IProcess : HandlerQueue
     virtual void create() = 0;
     virtual void init() = 0;
     virtual void disconnect() = 0;
+    virtual size_t hash() const = 0;
+    virtual ProcessState save() const = 0;
+    virtual void restore(const ProcessState&) = 0;
     
     ListHook node;
 };
@@ -54,6 +57,22 @@ struct Process : IProcess
     {
         on(Disconnect());
     }
+    
+    size_t hash() const override
+    {
+        return hashOf(hashOf(service), HandlerQueue::hash());
+    }
+    
+    ProcessState save() const override
+    {
+        return {std::make_shared<T_service>(service), HandlerQueue::save()};
+    }
+    
+    void restore(const ProcessState& state) override
+    {
+        service = *static_cast<const T_service*>(state.service.get());
+        HandlerQueue::restore(state.handlers);
+    }
 
 private:
     T_service service;
@@ -87,7 +106,7 @@ struct Node
         for (auto& p: processList)
         {
             p.create();
-            queues->push_back(p);
+            queues->add(p);
         }
     }
     
@@ -113,6 +132,34 @@ struct Node
         on = false;
     }
     
+    size_t hash() const
+    {
+        size_t h = on;
+        for (auto& p: processList)
+            hashCombine(h, p.hash());
+        return h;
+    }
+    
+    NodeState save() const
+    {
+        NodeState state{on, {}};
+        for (auto& p: processList)
+            state.processes.push_back(p.save());
+        return state;
+    }
+    
+    void restore(const NodeState& state)
+    {
+        on = state.on;
+        auto it = state.processes.begin();
+        for (auto& p: processList)
+        {
+            VERIFY(it != state.processes.end(), "Invalid process state");
+            p.restore(*it ++);
+            queues->add(p);
+        }
+    }
+    
 private:
     bool on = false;
     
@@ -23,15 +23,87 @@ struct IHandlerQueue : IObject
     virtual void push(NodeHandler&) = 0;
     
     ListHook queues; // list: all queues
+    int index = -1;  // position in the registered queues
 };
 
-using Queues = List<IHandlerQueue, &IHandlerQueue::queues>;
+/*
+ * Registered handler queues. The bit of the queue position is set while
+ * the queue is not empty: it is updated by the queue on push and pop thus
+ * the enabled queues are enumerated in the registration order without a scan.
+ */
+struct Queues : List<IHandlerQueue, &IHandlerQueue::queues>
+{
+    void add(IHandlerQueue& q)
+    {
+        q.index = registered.size();
+        registered.push_back(&q);
+        push_back(q);
+        if (words.size() * wordBits < registered.size())
+            words.push_back(0);
+        update(q);
+    }
+    
+    void clear()
+    {
+        List::clear();
+        for (auto* q: registered)
+            q->index = -1;
+        registered.clear();
+        std::fill(words.begin(), words.end(), 0);
+    }
+    
+    void update(const IHandlerQueue& q)
+    {
+        if (q.index == -1)
+            return;
+        const uint64_t bit = uint64_t(1) << (q.index % wordBits);
+        if (q.empty())
+            words[q.index / wordBits] &= ~bit;
+        else
+            words[q.index / wordBits] |= bit;
+    }
+    
+    size_t enabledCount() const
+    {
+        size_t count = 0;
+        for (uint64_t w: words)
+            count += std::bitset<wordBits>(w).count();
+        return count;
+    }
+    
+    // k-th nonempty queue in the registration order
+    IHandlerQueue& enabled(size_t k) const
+    {
+        for (size_t i = 0; i < words.size(); ++ i)
+        {
+            uint64_t w = words[i];
+            size_t count = std::bitset<wordBits>(w).count();
+            if (k >= count)
+            {
+                k -= count;
+                continue;
+            }
+            for (; k > 0; -- k)
+                w &= w - 1; // drops the lowest bit
+            size_t bit = std::bitset<wordBits>((w & (~w + 1)) - 1).count();
+            return *registered[i * wordBits + bit];
+        }
+        RAISE("Invalid enabled queue index");
+    }
+    
+private:
+    static constexpr size_t wordBits = 64;
+    
+    std::vector<IHandlerQueue*> registered;
+    std::vector<uint64_t> words;
+};
 
 struct HandlerQueue : IHandlerQueue
 {
     void clear() override
     {
         queue.clearDispose();
+        queues->update(*this);
     }
     
     bool empty() const override
@@ -46,15 +118,47 @@ struct HandlerQueue : IHandlerQueue
     
     NodeHandler& pop() override
     {
-        return queue.popFront();
+        NodeHandler& h = queue.popFront();
+        if (queue.empty())
+            queues->update(*this);
+        return h;
     }
     
     void push(NodeHandler& h) override
     {
+        h.owner = this;
         queue.push_back(h);
+        if (&queue.front() == &h)
+            queues->update(*this);
+    }
+
+    size_t hash() const
+    {
+        size_t h = 0;
+        for (auto&& handler: queue)
+            hashCombine(h, handler.stateHash());
+        return h;
+    }
+
+    std::vector<NodeHandler> save() const
+    {
+        return {queue.begin(), queue.end()};
+    }
+
+    void restore(const std::vector<NodeHandler>& handlers)
+    {
+        clear();
+        for (auto&& h: handlers)
+            push(NodeHandler::create(h));
     }
 
 private:
     List<NodeHandler, &NodeHandler::queue> queue;
+    An<Queues> queues;
 };
 
+// the invoked handler leaves its queue
+inline void dequeued(IHandlerQueue& q)
+{
+    An<Queues>()->update(q);
+}
@@ -19,6 +19,7 @@
 #include <set>
 #include <unordered_map>
 #include <algorithm>
+#include <array>
 
 template<typename T>
 std::set<T> operator-(const std::set<T>& s1, const std::set<T>& s2)
@@ -94,8 +95,12 @@ struct MsgId
 
     static int nextId()
     {
-        static int i = 0;
-        return ++ i;
+        return An<Ids>()->next();
+    }
+
+    size_t hash() const
+    {
+        return hashOf(id);
     }
 
     bool operator<(const MsgId& m) const
@@ -114,14 +119,25 @@ std::ostream& operator<<(std::ostream& o, const MsgId& m)
     return o << ":" << m.id;
 }
 
+inline size_t bitIndex(const MsgId& m)
+{
+    return m.id;
+}
+
 using NodeId = int;
 
-using CarrySet = std::set<MsgId>;
-using NodesSet = std::set<NodeId>;
+// ids of the nodes and messages are small: std::set<MsgId> and std::set<NodeId> work as well
+using CarrySet = BitSet<MsgId>;
+using NodesSet = BitSet<NodeId>;
 
 struct Apply
 {
     MsgId id;
+
+    size_t hash() const
+    {
+        return id.hash();
+    }
 };
 
 /*
@@ -136,11 +152,21 @@ struct ReplobSore : Service<ReplobSore>
     {
         CarrySet carrySet;
         NodesSet nodesSet;
+
+        size_t hash() const
+        {
+            return hashOf(carrySet, hashNodes(nodesSet));
+        }
     };
 
     struct Commit
     {
         CarrySet commitSet;
+
+        size_t hash() const
+        {
+            return hashOf(commitSet);
+        }
     };
 
     enum struct State
@@ -219,6 +245,11 @@ struct ReplobSore : Service<ReplobSore>
         committed = carries_;
     }
 
+    size_t hash() const
+    {
+        return hashOf(state_, hashNodes(nodes_), hashNodes(voted_), carries_, committed);
+    }
+
     State state_ = State::Initial;
     NodesSet nodes_;
     NodesSet voted_;
@@ -242,11 +273,21 @@ struct ReplobCalm : Service<ReplobCalm>
     {
         CarrySet carrySet;
         NodesSet nodesSet;
+
+        size_t hash() const
+        {
+            return hashOf(carrySet, hashNodes(nodesSet));
+        }
     };
 
     struct Commit
     {
         CarrySet commitSet;
+
+        size_t hash() const
+        {
+            return hashOf(commitSet);
+        }
     };
 
     enum struct State
@@ -345,6 +386,11 @@ struct ReplobCalm : Service<ReplobCalm>
         committed = carries_;
     }
 
+    size_t hash() const
+    {
+        return hashOf(state_, hashNodes(nodes_), hashNodes(voted_), carries_, committed);
+    }
+
     State state_ = State::ToVote;
     NodesSet nodes_;
     NodesSet voted_;
@@ -368,6 +414,11 @@ struct ReplobFlat : Service<ReplobFlat>
         CarrySet carries;
         NodesSet nodes;
         NodesSet votes;
+
+        size_t hash() const
+        {
+            return hashOf(carries, hashNodes(nodes), hashNodes(votes));
+        }
     };
 
     struct Commit {};
@@ -444,6 +495,11 @@ struct ReplobFlat : Service<ReplobFlat>
         broadcast(Commit{});
     }
 
+    size_t hash() const
+    {
+        return hashOf(state_, hashNodes(nodes_), hashNodes(votes_), carries_, committed);
+    }
+
     State state_ = State::Voting;
     NodesSet nodes_;
     NodesSet votes_;
@@ -464,6 +520,11 @@ struct ReplobMost : Service<ReplobMost>
     {
         CarrySet carries;
         NodesSet nodes;
+
+        size_t hash() const
+        {
+            return hashOf(carries, hashNodes(nodes));
+        }
     };
 
     struct Commit {};
@@ -566,6 +627,14 @@ struct ReplobMost : Service<ReplobMost>
         return true;
     }
 
+    size_t hash() const
+    {
+        size_t carryVotes = 0;
+        for (auto&& kv: carryVotes_)
+            carryVotes += hashMix(hashOf(kv.first, hashNodes(kv.second)));
+        return hashOf(state_, hashNodes(aliveNodes_), hashNodes(votes_), carryVotes, carries_, committed);
+    }
+
     State state_ = State::Voting;
 
     NodesSet aliveNodes_;
@@ -580,19 +649,55 @@ struct ReplobMost : Service<ReplobMost>
 
 using Messages = std::vector<MsgId>;
 
-struct VectorMessageHash
+/*
+ * Interned message sequences: the sequence is the node of its prefix and
+ * the last message thus the sequence is a single integer. Ids are valid
+ * in the world of the thread only while the hash depends on the content.
+ */
+struct Sequences
 {
-    template<typename T>
-    size_t operator()(const std::vector<T>& vec) const
+    using Id = int; // 0: empty sequence
+
+    Sequences()
     {
-        size_t res = 0;
-        for (auto&& t: vec)
-        {
-            res ^= t.id;
-            res <<= 5;
-        }
-        return res;
+        nodes.push_back({-1, -1, 0});
     }
+
+    Id append(Id parent, const MsgId& msg)
+    {
+        uint64_t key = (uint64_t(parent) << 32) | uint32_t(msg.id);
+        auto it = index.find(key);
+        if (it != index.end())
+            return it->second;
+        Id id = nodes.size();
+        nodes.push_back({parent, msg.id, hashOf(nodes[parent].hash, msg)});
+        index.emplace(key, id);
+        return id;
+    }
+
+    Id intern(const Messages& messages)
+    {
+        Id id = 0;
+        for (auto&& msg: messages)
+            id = append(id, msg);
+        return id;
+    }
+
+    size_t hash(Id id) const
+    {
+        return nodes[id].hash;
+    }
+
+private:
+    struct Node
+    {
+        Id parent;
+        int msg;
+        size_t hash;
+    };
+
+    std::vector<Node> nodes;
+    std::unordered_map<uint64_t, Id> index;
 };
 
 namespace std {
@@ -614,15 +719,12 @@ int majority()
 }
 
 /*
- * The most powerful and complex algorithm.
- * It tries to completely avoid waiting messages from all nodes
- * and allows partial commitment.
- * It's important to emphasize that there is no handler on disconnection.
+ * State machine of the Rush algorithm shared by the full state and
+ * the delta protocols: the incoming data is merged by the phases,
+ * the caller broadcasts the changes.
  */
-struct ReplobRush : Service<ReplobRush>
+struct RushCore
 {
-    using Service<ReplobRush>::on;
-
     struct MessagesGeneration
     {
         Messages messages;
@@ -632,13 +734,40 @@ struct ReplobRush : Service<ReplobRush>
         {
             return messages == m.messages && generation == m.generation;
         }
+
+        bool operator!=(const MessagesGeneration& m) const
+        {
+            return !this->operator==(m);
+        }
+
+        size_t hash() const
+        {
+            return hashOf(messages, generation);
+        }
     };
 
+    // votes of the nodes for the messages at the same position
+    struct Tally
+    {
+        std::array<uint8_t, 64> counts{}; // by message id
+        int majorityId = -1;
+    };
+
+    using Promises = std::unordered_map<Sequences::Id, NodesSet>; // by interned messages
+
+    static size_t hashPromises(const Promises& promises)
+    {
+        size_t h = 0;
+        for (auto&& kv: promises)
+            h += hashMix(hashOf(An<Sequences>()->hash(kv.first), hashNodes(kv.second)));
+        return h;
+    }
+
     struct State
     {
         CarrySet carries;
         std::vector<MessagesGeneration> nodesMessages;
-        std::unordered_map<Messages, NodesSet, VectorMessageHash> promises;
+        Promises promises;
 
         bool operator==(const State& s) const
         {
@@ -650,19 +779,9 @@ struct ReplobRush : Service<ReplobRush>
             return !this->operator==(s);
         }
 
-        MsgId getMajorityId(int idx) const
+        size_t hash() const
         {
-            std::unordered_map<MsgId, int> count;
-            for (auto&& gen: nodesMessages)
-            {
-                if (idx < gen.messages.size())
-                {
-                    auto&& id = gen.messages[idx];
-                    if (++ count[id] >= majority())
-                        return id;
-                }
-            }
-            return MsgId{-1};
+            return hashOf(carries, hashByNode(nodesMessages), hashPromises(promises));
         }
 
         MessagesGeneration& current()
@@ -677,56 +796,91 @@ struct ReplobRush : Service<ReplobRush>
         Committed,
     };
 
-    void on(const Init&)
+    void initState()
     {
         state_.nodesMessages.resize(config->nodes);
     }
 
-    void on(const Apply& apply)
+    void beginMerge()
     {
-        SLOG("Apply");
-        on(State{CarrySet{apply.id}, std::vector<MessagesGeneration>(config->nodes), std::unordered_map<Messages, NodesSet, VectorMessageHash>()});
+        changed_ = false;
+        generation_ = state_.current().generation;
     }
 
-    void on(const State& incomingState)
+    MsgId getMajorityId(int idx) const
     {
-        if (status_ == Status::Committed)
-            return;
-        SLOG("incoming state");
-        State newState;
-        newState.nodesMessages = state_.nodesMessages;
-        // union messages
-        for (int i = 0; i < config->nodes; ++ i)
+        return MsgId{idx < tallies_.size() ? tallies_[idx].majorityId : -1};
+    }
+
+    void setMessages(int node, const MessagesGeneration& gen)
+    {
+        vote(state_.nodesMessages[node].messages, 0, -1);
+        state_.nodesMessages[node] = gen;
+        vote(state_.nodesMessages[node].messages, 0, 1);
+    }
+
+    void addMessage(const MsgId& id)
+    {
+        auto&& messages = state_.current().messages;
+        messages.push_back(id);
+        vote(messages, messages.size() - 1, 1);
+    }
+
+    // returns true if the order is changed
+    bool sortMessages(int from)
+    {
+        auto&& messages = state_.current().messages;
+        if (std::is_sorted(messages.begin() + from, messages.end()))
+            return false;
+        vote(messages, from, -1);
+        std::sort(messages.begin() + from, messages.end());
+        vote(messages, from, 1);
+        return true;
+    }
+
+    // union messages
+    void mergeMessages(int node, const MessagesGeneration& gen)
+    {
+        if (gen.generation > state_.nodesMessages[node].generation)
         {
-            if (incomingState.nodesMessages[i].generation > newState.nodesMessages[i].generation)
-            {
-                newState.nodesMessages[i] = incomingState.nodesMessages[i];
-            }
+            setMessages(node, gen);
+            changed_ = true;
         }
-        // add new messages
-        newState.carries = state_.carries;
-        for (auto&& msg: incomingState.carries - newState.carries)
+    }
+
+    // add new messages
+    void mergeCarries(const CarrySet& carries)
+    {
+        for (auto&& msg: carries - state_.carries)
         {
-            newState.carries.insert(msg);
-            newState.current().messages.push_back(msg);
-            newState.current().generation = state_.current().generation + 1;
+            state_.carries.insert(msg);
+            addMessage(msg);
+            state_.current().generation = generation_ + 1;
+            changed_ = true;
         }
-        // iteration and promising
+    }
+
+    // iteration, promising and commit, returns true if the state is changed
+    bool promise(const Promises& incomingPromises)
+    {
         bool sorted = false;
         Messages promiseMessages = committed;
         Messages commitMessages = committed;
-        for (int i = committed.size(); i < newState.carries.size(); ++ i)
+        Sequences::Id promise = sequences->intern(committed);
+        Promises promises;
+        for (int i = committed.size(); i < state_.carries.size(); ++ i)
         {
-            MsgId id = newState.getMajorityId(i);
+            MsgId id = getMajorityId(i);
             if (id.id >= 0)
             {
                 // found majority, add promise
                 SLOG("found majority, add promise: " << id.id);
                 promiseMessages.push_back(id);
+                promise = sequences->append(promise, id);
                 NodesSet votes = NodesSet{context().currentNode}
-                        | findOrEmpty(state_.promises, promiseMessages)
-                        | findOrEmpty(incomingState.promises, promiseMessages);
-                newState.promises[promiseMessages] = votes;
+                        | findOrEmpty(state_.promises, promise)
+                        | findOrEmpty(incomingPromises, promise);
+                promises[promise] = votes;
                 if (votes.size() >= majority())
                 {
                     // votes has majority => may be committed
@@ -741,8 +895,7 @@ struct ReplobRush : Service<ReplobRush>
                     // try to sort
                     SLOG("try to sort from: " << i);
                     sorted = true;
-                    auto&& messages = newState.current().messages;
-                    std::sort(messages.begin() + i, messages.end());
+                    changed_ |= sortMessages(i);
                     // retry attempt
                     -- i;
                     continue;
@@ -754,12 +907,14 @@ struct ReplobRush : Service<ReplobRush>
                 }
             }
         }
-        if (newState != state_)
+        if (promises != state_.promises)
         {
-            // update state and generation
-            SLOG("update state with generation: " << newState.current().generation);
-            state_ = newState;
-            broadcast(newState);
+            state_.promises = std::move(promises);
+            changed_ = true;
+        }
+        if (changed_)
+        {
+            SLOG("update state with generation: " << state_.current().generation);
             if (commitMessages != committed)
             {
                 SLOG("new committed messages" << commitMessages);
@@ -768,6 +923,73 @@ struct ReplobRush : Service<ReplobRush>
                 committed = commitMessages;
             }
         }
+        return changed_;
+    }
+
+    Status status_ = Status::Voting;
+    State state_;
+    std::vector<Tally> tallies_; // by position, follows state_.nodesMessages
+
+    Messages committed;
+    An<Config> config;
+    An<Sequences> sequences;
+
+private:
+    // only one message may have the majority at the position
+    void vote(const Messages& messages, size_t from, int delta)
+    {
+        if (tallies_.size() < messages.size())
+            tallies_.resize(messages.size());
+        for (size_t i = from; i < messages.size(); ++ i)
+        {
+            const int id = messages[i].id;
+            VERIFY(id >= 0 && id < 64, "Message id is out of range");
+            Tally& t = tallies_[i];
+            t.counts[id] += delta;
+            if (t.counts[id] >= majority())
+                t.majorityId = id;
+            else if (t.majorityId == id)
+                t.majorityId = -1;
+        }
+    }
+
+    bool changed_ = false;
+    int generation_ = 0;
+};
+
+/*
+ * The most powerful and complex algorithm.
+ * It tries to completely avoid waiting messages from all nodes
+ * and allows partial commitment.
+ * It's important to emphasize that there is no handler on disconnection.
+ */
+struct ReplobRush : Service<ReplobRush>, RushCore
+{
+    using Service<ReplobRush>::on;
+
+    void on(const Init&)
+    {
+        initState();
+    }
+
+    void on(const Apply& apply)
+    {
+        SLOG("Apply");
+        on(State{CarrySet{apply.id}, std::vector<MessagesGeneration>(config->nodes), {}});
+    }
+
+    // merges the incoming state in place, the state is broadcasted if changed
+    void on(const State& incomingState)
+    {
+        if (status_ == Status::Committed)
+            return;
+        SLOG("incoming state");
+        beginMerge();
+        for (int i = 0; i < config->nodes; ++ i)
+            mergeMessages(i, incomingState.nodesMessages[i]);
+        mergeCarries(incomingState.carries);
+        if (promise(incomingState.promises))
+            broadcast(state_);
     }
 
     void on(const Disconnect&)
@@ -775,11 +997,122 @@ struct ReplobRush : Service<ReplobRush>
         SLOG("Disconnect");
     }
 
-    Status status_ = Status::Voting;
-    State state_;
+    size_t hash() const
+    {
+        return hashOf(status_, state_, committed);
+    }
+};
 
-    Messages committed;
-    An<Config> config;
+/*
+ * Rush with the delta protocol: the node broadcasts only the changes
+ * since its previous broadcast. Channels are FIFO thus the receiver
+ * accumulates the promises of each peer, the messages and the carries
+ * are merged monotonically: the result is the same as for the full state.
+ */
+struct ReplobRushDelta : Service<ReplobRushDelta>, RushCore
+{
+    using Service<ReplobRushDelta>::on;
+
+    struct Delta
+    {
+        CarrySet carries; // new carries
+        std::vector<std::pair<int, MessagesGeneration>> nodesMessages; // changed by node
+        std::vector<std::pair<Sequences::Id, NodesSet>> promises; // changed promises
+        std::vector<Sequences::Id> revoked; // removed promises
+
+        size_t hash() const
+        {
+            size_t h = 0;
+            for (auto&& m: nodesMessages)
+                h += hashMix(hashOf(hashNode(m.first), m.second));
+            Promises changed{promises.begin(), promises.end()};
+            size_t r = 0;
+            for (auto id: revoked)
+                r += hashMix(An<Sequences>()->hash(id));
+            return hashOf(carries, h, hashPromises(changed), r);
+        }
+    };
+
+    void on(const Init&)
+    {
+        initState();
+        sent_ = state_;
+        peers_.resize(config->nodes);
+    }
+
+    void on(const Apply& apply)
+    {
+        SLOG("Apply");
+        if (status_ == Status::Committed)
+            return;
+        beginMerge();
+        mergeCarries(CarrySet{apply.id});
+        if (promise({}))
+            broadcastDelta();
+    }
+
+    void on(const Delta& delta)
+    {
+        if (status_ == Status::Committed)
+            return;
+        SLOG("incoming delta");
+        Promises& peer = peers_[context().sourceNode];
+        for (auto&& p: delta.promises)
+            peer[p.first] = p.second;
+        for (auto id: delta.revoked)
+            peer.erase(id);
+        beginMerge();
+        for (auto&& m: delta.nodesMessages)
+            mergeMessages(m.first, m.second);
+        mergeCarries(delta.carries);
+        if (promise(peer))
+            broadcastDelta();
+    }
+
+    void on(const Disconnect&)
+    {
+        SLOG("Disconnect");
+    }
+
+    size_t hash() const
+    {
+        // the last promises belong to the peer like hashByNode does
+        size_t peers = peers_.size();
+        for (size_t i = 0; i < peers_.size(); ++ i)
+            peers += hashMix(hashOf(hashNode(i), hashPromises(peers_[i])));
+        return hashOf(status_, state_, committed, sent_, peers);
+    }
+
+private:
+    // the difference from the previous broadcast, the peer states are updated
+    void broadcastDelta()
+    {
+        Delta delta;
+        delta.carries = state_.carries - sent_.carries;
+        sent_.carries = state_.carries;
+        for (int i = 0; i < config->nodes; ++ i)
+        {
+            if (state_.nodesMessages[i] != sent_.nodesMessages[i])
+            {
+                delta.nodesMessages.emplace_back(i, state_.nodesMessages[i]);
+                sent_.nodesMessages[i] = state_.nodesMessages[i];
+            }
+        }
+        for (auto&& p: state_.promises)
+        {
+            auto it = sent_.promises.find(p.first);
+            if (it == sent_.promises.end() || it->second != p.second)
+                delta.promises.push_back(p);
+        }
+        for (auto&& p: sent_.promises)
+            if (state_.promises.count(p.first) == 0)
+                delta.revoked.push_back(p.first);
+        sent_.promises = state_.promises;
+        broadcast(std::move(delta));
+    }
+
+    State sent_; // the state known by the peers
+    std::vector<Promises> peers_; // the last promises of each peer
 };
 
 template<typename T_replob>
@@ -827,6 +1160,11 @@ struct Client : Service<Client<T_replob>>
         }
     }
 
+    size_t hash() const
+    {
+        return hashNodes(disconnected);
+    }
+
     NodesSet disconnected;
     ServiceAccessor accessor;
     An<Config> config;
@@ -842,16 +1180,27 @@ void testReplobImpl(int clientCommits)
     config->maxFails = 1;
     config->maxIterations = 0;
     config->maxFailedNodes = 1;
+    config->minimize = true;
+    config->algorithm = getTypeName<R>();
+    // the failed variants are recorded to and replayed from the trace files without recompiling
+    if (const char* trace = std::getenv("DAVE_TRACE"))
+        config->traceFile = trace;
 
     ServiceCreator c;
     c.create<C>(0, clientCommits);
     c.create<R>(0, c.config().nodes);
+    // replobs without clients are interchangeable
+    for (int n = std::max(clientCommits, config->minUnreliableNode); n < config->nodes; ++ n)
+        config->symmetricNodes.push_back(n);
 
     ServiceAccessor a;
     TrueScheduler s {[&a] {
         a.service<C>(0).test();
     }};
-    s.run();
+    if (const char* replay = std::getenv("DAVE_REPLAY"))
+        s.replay(replay);
+    else
+        s.run();
     //s.checkVariant({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2});
 }
 
@@ -867,3 +1216,4 @@ DEF_REPLOB(ReplobCalm)
 DEF_REPLOB(ReplobFlat)
 DEF_REPLOB(ReplobMost)
 DEF_REPLOB(ReplobRush)
+DEF_REPLOB(ReplobRushDelta)
@@ -78,32 +78,334 @@ private:
     An<Emulator> emulator;
 };
 
+/*
+ * Handler invoked on the node reads and writes the services of the node
+ * only (services of the node may call each other directly), disconnection
+ * affects all nodes. Handlers sending to the same node are dependent
+ * as well: the order of the messages in the queue differs.
+ * Handlers with disjoint footprints commute.
+ */
+struct Footprint
+{
+    int node = -1;
+    bool disconnect = false;
+    uint64_t sends = 0; // destination nodes of the created handlers, known after invocation
+
+    Footprint() = default;
+
+    Footprint(const NodeHandler& h)
+        : node{h.context.currentNode}, disconnect{h.type == EventType::Disconnect}
+    {
+    }
+
+    bool dependent(const Footprint& f) const
+    {
+        return disconnect || f.disconnect || node == f.node || (sends & f.sends) != 0;
+    }
+};
+
+// explored handler that must not be chosen until the dependent handler is invoked
+struct Sleeper
+{
+    int64_t id;
+    Footprint footprint;
+};
+
+using SleepSet = std::vector<Sleeper>;
+
+// sleepers that stay asleep after the handler is invoked
+inline SleepSet awake(const SleepSet& sleep, const Footprint& footprint)
+{
+    SleepSet result;
+    for (auto&& s: sleep)
+        if (!s.footprint.dependent(footprint))
+            result.push_back(s);
+    return result;
+}
+
+/*
+ * Prefix tree of the variants: the node keeps the choices made since
+ * its parent thus the variants added on the same path share the prefix.
+ */
+struct Prefix
+{
+    std::shared_ptr<const Prefix> parent;
+    std::vector<uint8_t> choices;
+    size_t depth = 0; // length of the variant ending at the node
+};
+
+using PrefixPtr = std::shared_ptr<const Prefix>;
+
+// node of the variant: the prefix is extended by the rest of the choices
+inline PrefixPtr extendPrefix(const PrefixPtr& prefix, const Variant& v)
+{
+    size_t from = prefix ? prefix->depth : 0;
+    if (from == v.size())
+        return prefix;
+    auto node = std::make_shared<Prefix>();
+    node->parent = prefix;
+    node->depth = v.size();
+    for (size_t i = from; i < v.size(); ++ i)
+    {
+        VERIFY(v[i] >= 0 && v[i] <= 0xff, "Choice index must fit the byte");
+        node->choices.push_back(v[i]);
+    }
+    return node;
+}
+
+inline void materialize(const Prefix* node, Variant& v)
+{
+    v.resize(node ? node->depth : 0);
+    for (; node != nullptr; node = node->parent.get())
+        std::copy(node->choices.begin(), node->choices.end(), v.begin() + (node->depth - node->choices.size()));
+}
+
+// deviations of the variant from the first trigger path
+struct Deviations
+{
+    int preemptions = 0; // chosen triggers other than the first one
+    int faults = 0; // chosen disconnections
+};
+
+// variant to explore and the optional snapshot of the state reached by its prefix
+struct Branch
+{
+    Variant variant;
+    PrefixPtr prefix; // node of the tree, the variant starts with
+    SnapshotPtr snapshot;
+    SleepSet sleep; // sleep set of the state before the last step of the variant
+    Deviations deviations;
+};
+
+/*
+ * Variants to explore shared among worker threads.
+ * Each worker has its own deque used as LIFO stack thus DFS stays local.
+ * Idle worker steals from the front of other deques: the shortest
+ * variants, i.e. the largest subtrees to explore.
+ * Variants are stored as the prefix tree node and the last choice
+ * and materialized on get().
+ * The deque that exceeds the spill limit moves its oldest half to disk
+ * without snapshots, the chunk is loaded back when the deque is empty.
+ * Deferred variants are kept in the separate deques without snapshots
+ * and become the variants to explore on the next level.
+ */
 struct Variants
 {
-    void add(Variant v)
+    void init(int workers, int64_t spill = 0)
+    {
+        spillLimit = spill;
+        deques.clear();
+        later.clear();
+        for (int i = 0; i < workers; ++ i)
+        {
+            deques.emplace_back(new Deque);
+            later.emplace_back(new Deque);
+        }
+        pending = 0;
+        deferred = 0;
+        stopped = false;
+    }
+    
+    // must be called by the worker thread before using the variants
+    void attach(int worker)
+    {
+        VERIFY(worker < int(deques.size()), "Invalid worker index");
+        current() = worker;
+    }
+    
+    // empty variant: the exploration starts from it
+    void addRoot()
+    {
+        add({});
+    }
+    
+    // variant of the prefix node extended by the choice
+    void addExtent(PrefixPtr prefix, int nv, SnapshotPtr snapshot = {}, SleepSet sleep = {}, Deviations deviations = {})
+    {
+        VERIFY(nv >= 0 && nv <= 0xff, "Choice index must fit the byte");
+        CLOG("added extent: " << nv << " on depth " << (prefix ? prefix->depth : 0));
+        add({std::move(prefix), int16_t(nv), std::move(snapshot), std::move(sleep), deviations});
+    }
+    
+    // variant explored on the next level, -1: the prefix itself
+    void defer(PrefixPtr prefix, int nv, SleepSet sleep = {}, Deviations deviations = {})
+    {
+        VERIFY(nv >= -1 && nv <= 0xff, "Choice index must fit the byte");
+        ++ deferred;
+        push(*later[current()], {std::move(prefix), int16_t(nv), {}, std::move(sleep), deviations});
+    }
+    
+    // the deferred variants become the variants to explore,
+    // must be called when all the variants are processed
+    int64_t nextLevel()
+    {
+        VERIFY(pending == 0, "Variants of the level must be processed");
+        std::swap(deques, later);
+        pending = deferred.exchange(0);
+        return pending;
+    }
+    
+    // waits while the other workers may produce new variants,
+    // the worker must call done() after the variant is processed
+    bool get(Branch& b)
+    {
+        Pending p;
+        while (!stopped)
+        {
+            if (popBack(current(), p) || steal(p))
+            {
+                materialize(p.prefix.get(), b.variant);
+                if (p.choice != -1)
+                    b.variant.push_back(p.choice);
+                b.prefix = std::move(p.prefix);
+                b.snapshot = std::move(p.snapshot);
+                b.sleep = std::move(p.sleep);
+                b.deviations = p.deviations;
+                return true;
+            }
+            if (pending == 0)
+                return false;
+            std::this_thread::yield();
+        }
+        return false;
+    }
+    
+    void done()
+    {
+        -- pending;
+    }
+    
+    // cooperative cancellation: workers stop on the next get()
+    void stop()
+    {
+        stopped = true;
+    }
+    
+    bool isStopped() const
+    {
+        return stopped;
+    }
+    
+private:
+    struct Pending
     {
-        CLOG("added variant: " << v);
-        variants.push_back(std::move(v));
+        PrefixPtr prefix;
+        int16_t choice = -1; // -1: the variant of the prefix itself
+        SnapshotPtr snapshot;
+        SleepSet sleep;
+        Deviations deviations;
+    };
+    
+    struct Deque
+    {
+        std::mutex mutex;
+        std::deque<Pending> variants;
+        ChunkStack spilled; // older than the variants in memory
+    };
+    
+    void add(Pending p)
+    {
+        ++ pending;
+        push(*deques[current()], std::move(p));
+    }
+    
+    void push(Deque& d, Pending p)
+    {
+        std::lock_guard<std::mutex> lock{d.mutex};
+        d.variants.push_back(std::move(p));
+        if (spillLimit != 0 && int64_t(d.variants.size()) > spillLimit)
+            spill(d);
+    }
+    
+    void spill(Deque& d)
+    {
+        size_t count = std::max<size_t>(d.variants.size() / 2, 1);
+        ChunkWriter w;
+        w.put(count);
+        Variant v;
+        for (size_t i = 0; i < count; ++ i)
+        {
+            Pending& p = d.variants[i];
+            materialize(p.prefix.get(), v);
+            w.put(v.size());
+            for (int choice: v)
+                w.put(uint8_t(choice));
+            w.put(p.choice);
+            w.put(p.sleep.size());
+            for (auto&& s: p.sleep)
+                w.put(s);
+            w.put(p.deviations);
+        }
+        d.variants.erase(d.variants.begin(), d.variants.begin() + count);
+        d.spilled.push(w.data);
+        CLOG("spilled variants: " << count);
     }
     
-    void addExtent(const Variant& v, int nv)
+    void load(Deque& d)
     {
-        Variant newV = v;
-        newV.push_back(nv);
-        add(std::move(newV));
+        std::string chunk = d.spilled.pop();
+        ChunkReader r{chunk};
+        size_t count = r.get<size_t>();
+        Variant v;
+        for (size_t i = 0; i < count; ++ i)
+        {
+            v.resize(r.get<size_t>());
+            for (int& choice: v)
+                choice = r.get<uint8_t>();
+            Pending p;
+            p.prefix = extendPrefix(nullptr, v);
+            p.choice = r.get<int16_t>();
+            p.sleep.resize(r.get<size_t>());
+            for (auto&& s: p.sleep)
+                s = r.get<Sleeper>();
+            p.deviations = r.get<Deviations>();
+            d.variants.push_back(std::move(p));
+        }
+        VERIFY(r.atEnd(), "Invalid spilled chunk");
+        CLOG("loaded variants: " << count);
     }
     
-    bool get(Variant& v)
+    bool popBack(int worker, Pending& v)
     {
-        if (variants.empty())
+        Deque& d = *deques[worker];
+        std::lock_guard<std::mutex> lock{d.mutex};
+        if (d.variants.empty() && !d.spilled.empty())
+            load(d);
+        if (d.variants.empty())
             return false;
-        v = std::move(variants.back());
-        variants.pop_back();
+        v = std::move(d.variants.back());
+        d.variants.pop_back();
         return true;
     }
     
-private:
-    std::vector<Variant> variants;
+    bool steal(Pending& v)
+    {
+        int count = deques.size();
+        for (int i = 1; i < count; ++ i)
+        {
+            Deque& d = *deques[(current() + i) % count];
+            std::lock_guard<std::mutex> lock{d.mutex};
+            if (d.variants.empty())
+                continue;
+            v = std::move(d.variants.front());
+            d.variants.pop_front();
+            CLOG("stolen extent: " << v.choice);
+            return true;
+        }
+        return false;
+    }
+    
+    static int& current()
+    {
+        return single<int, Variants>();
+    }
+    
+    std::vector<std::unique_ptr<Deque>> deques;
+    std::vector<std::unique_ptr<Deque>> later; // deferred to the next level
+    int64_t spillLimit = 0;
+    std::atomic<int64_t> pending{0}; // queued and being processed variants
+    std::atomic<int64_t> deferred{0};
+    std::atomic<bool> stopped{false};
 };
 
 struct ServiceAccessor
@@ -118,43 +420,238 @@ private:
     An<Nodes> nodes;
 };
 
+/*
+ * Shrinks the failed variant by delta debugging: the chunks of the steps
+ * are removed while the replay fails, then the adjacent steps are swapped
+ * while the variant gets closer to the first trigger path. The steps are
+ * the handler names thus the removed step does not shift the rest:
+ * the step invokes the first available handler of the name. The replay is
+ * completed by the first triggers like FrontScheduler does. Any verification
+ * failure of the end check is accepted.
+ */
+struct Minimizer
+{
+    using Steps = std::vector<HandlerName>;
+    
+    Minimizer(const Handler& end) : onEnd(end) {}
+    
+    Variant minimize(const Variant& v)
+    {
+        Steps steps;
+        Variant best;
+        if (!fails(names(v), best, steps))
+        {
+            RLOG("Failed sequence is not reproduced by the handler names");
+            return v;
+        }
+        reduce(steps, best);
+        reorder(steps, best);
+        return best;
+    }
+    
+private:
+    void reduce(Steps& steps, Variant& best)
+    {
+        size_t parts = 2;
+        while (steps.size() >= 2)
+        {
+            size_t chunk = (steps.size() + parts - 1) / parts;
+            bool reduced = false;
+            for (size_t from = 0; from < steps.size() && !reduced; from += chunk)
+            {
+                Steps candidate = steps;
+                candidate.erase(candidate.begin() + from, candidate.begin() + std::min(from + chunk, steps.size()));
+                reduced = accept(candidate, steps, best, [&best](const Variant& r) {
+                    return r.size() < best.size();
+                });
+            }
+            if (reduced)
+                parts = std::max<size_t>(parts - 1, 2);
+            else if (parts >= steps.size())
+                break;
+            else
+                parts = std::min(parts * 2, steps.size());
+        }
+    }
+    
+    void reorder(Steps& steps, Variant& best)
+    {
+        // each accepted swap decreases the variant thus the passes are bounded
+        for (size_t pass = 0; pass < steps.size(); ++ pass)
+        {
+            bool swapped = false;
+            for (size_t i = 0; i + 1 < steps.size(); ++ i)
+            {
+                if (steps[i] == steps[i + 1])
+                    continue;
+                Steps candidate = steps;
+                std::swap(candidate[i], candidate[i + 1]);
+                swapped |= accept(candidate, steps, best, [&best](const Variant& r) {
+                    return r.size() <= best.size() && r < best;
+                });
+            }
+            if (!swapped)
+                break;
+        }
+    }
+    
+    template<typename F_better>
+    bool accept(const Steps& candidate, Steps& steps, Variant& best, F_better better)
+    {
+        Variant result;
+        Steps executed;
+        if (!fails(candidate, result, executed) || !better(result))
+            return false;
+        CLOG("minimized sequence: " << result);
+        steps = std::move(executed);
+        best = std::move(result);
+        return true;
+    }
+    
+    Steps names(const Variant& v)
+    {
+        init();
+        Steps steps;
+        for (int i: v)
+        {
+            NodeHandler& h = *emulator->available().at(i);
+            steps.push_back(h.name);
+            h.invoke();
+        }
+        return steps;
+    }
+    
+    // replays the steps completed by the first triggers,
+    // returns true if the end check fails
+    bool fails(const Steps& steps, Variant& result, Steps& executed)
+    {
+        init();
+        for (auto&& name: steps)
+        {
+            int i = find([&name](const NodeHandler& h) {
+                return h.name == name;
+            });
+            if (i == -1)
+                return false;
+            invoke(i, result, executed);
+        }
+        while (int(result.size()) < config->maxSteps)
+        {
+            int i = find([](const NodeHandler& h) {
+                return h.type == EventType::Trigger;
+            });
+            if (i == -1)
+                break;
+            invoke(i, result, executed);
+        }
+        try
+        {
+            onEnd();
+        }
+        catch (VerificationFail&)
+        {
+            return true;
+        }
+        return false;
+    }
+    
+    // index of the first available handler matching the predicate, -1: none
+    template<typename F_match>
+    int find(F_match match)
+    {
+        auto available = emulator->available();
+        for (size_t i = 0; i < available.size(); ++ i)
+            if (match(*available[i]))
+                return i;
+        return -1;
+    }
+    
+    void invoke(int i, Variant& result, Steps& executed)
+    {
+        NodeHandler& h = *emulator->available()[i];
+        result.push_back(i);
+        executed.push_back(h.name);
+        h.invoke();
+    }
+    
+    void init()
+    {
+        stats->init();
+        emulator->init();
+    }
+    
+    const Handler& onEnd;
+    An<Emulator> emulator;
+    An<Stats> stats;
+    An<Config> config;
+};
+
 struct Scheduler : IObject
 {
     Scheduler(Handler end) : onEnd(std::move(end))
     {
     }
     
-    virtual Variant runIteration(Variant v) = 0;
+    // extends the variant till the end, returns false if the end state
+    // must not be verified: the rest is already explored
+    virtual bool runIteration(Branch& b) = 0;
     
     void init()
     {
-        emulator->init();
+        // handlers created on init refer to the steps
         stats->init();
+        emulator->init();
     }
     
-    void run()
+    // breadth and deepening frontiers explore the levels bounded by the depth:
+    // the first violation found is the shortest one up to the level steps
+    virtual void run()
     {
-        variants->add({});
-        for (int i = 0; i < config->maxIterations || config->maxIterations == 0; ++ i)
+        VERIFY(!config->sleepSets || !config->stateful(), "Sleep sets cannot be used in stateful mode");
+        VERIFY(config->visitedStates == 0 || config->bitstateBits == 0, "Visited states and bitstate tables are exclusive");
+        VERIFY(config->levelSteps > 0, "Level must add the steps");
+        variants.init(std::max(config->threads, 1), config->spillVariants);
+        initVisited();
+        variants.attach(0);
+        variants.addRoot();
+        limit = config->frontier == Frontier::Depth ? 0 : config->levelSteps;
+        while (true)
         {
-            Variant v;
-            if (!variants->get(v))
-            {
-                CLOG("no variants");
+            int64_t iterations = globalStats->iterations;
+            explore();
+            if (limit == 0 || variants.isStopped())
                 break;
+            RLOG("level " << limit << ": variants: " << globalStats->iterations - iterations);
+            if (config->frontier == Frontier::Breadth)
+            {
+                if (variants.nextLevel() == 0)
+                    break;
             }
-            ++ globalStats->iterations;
-            execVariant(v);
-            auto vend = runIteration(std::move(v));
-            if (finalize(vend))
-                break;
-            if ((i+1) % config->progressIterations == 0)
+            else
             {
-                RLOG("global stats: " << *globalStats);
-                RLOG("Variant: " << vend);
+                if (!cut)
+                    break;
+                cut = false;
+                // the states are expanded again by more steps
+                initVisited();
+                variants.attach(0);
+                variants.addRoot();
             }
+            limit += config->levelSteps;
         }
         RLOG("global stats: " << *globalStats);
+        if (config->bitstateBits != 0)
+            RLOG("bitstate: " << bitStates);
+        else if (config->stateful())
+            RLOG("visited states: " << visitedStates.size());
+    }
+
+    void explore()
+    {
+        Workers().run(config->threads, [this](int worker) {
+            variants.attach(worker);
+            work();
+        });
     }
 
     bool finalize(const Variant& v)
@@ -166,9 +663,22 @@ struct Scheduler : IObject
         }
         catch (VerificationFail&)
         {
+            int failNum = ++ fails;
+            if (config->maxFails != 0 && failNum > config->maxFails)
+                return true; // max fails is reached by other worker
             RLOG("Failed sequence: " << v);
-            execVariant(v, true);
-            if (++ fails == config->maxFails)
+            Variant shown = v;
+            if (config->minimize)
+            {
+                shown = Minimizer{onEnd}.minimize(v);
+                RLOG("Minimized sequence: " << shown);
+            }
+            Trace t;
+            t.setConfig(*config);
+            execVariant(shown, true, &t);
+            if (!config->traceFile.empty())
+                traces.write(config->traceFile, t);
+            if (failNum == config->maxFails)
             {
                 RLOG("Max fails reached");
                 return true;
@@ -178,87 +688,931 @@ struct Scheduler : IObject
         return false;
     }
     
-    void execVariant(const Variant& v, bool show = false)
+    // worker loop: the worker owns the world of the current thread
+    void work()
+    {
+        Branch b;
+        while (variants.get(b))
+        {
+            int64_t i = ++ globalStats->iterations;
+            if (config->maxIterations != 0 && i > config->maxIterations)
+            {
+                -- globalStats->iterations;
+                variants.done();
+                variants.stop();
+                break;
+            }
+            execBranch(b);
+            b.snapshot.reset();
+            bool stop = runIteration(b) && !checked(b.variant) && finalize(b.variant);
+            variants.done();
+            if (stop)
+            {
+                variants.stop();
+                break;
+            }
+            if (i % config->progressIterations == 0)
+            {
+                RLOG("global stats: " << *globalStats);
+                RLOG("Variant: " << b.variant);
+            }
+        }
+    }
+    
+    void execVariant(const Variant& v, bool show = false, Trace* trace = nullptr)
     {
         CLOG("init");
         init();
         CLOG("executing variant from scratch: " << v);
         for (int i: v)
         {
+            NodeHandler& h = *emulator->available().at(i);
             if (show)
-                emulator->available().at(i)->rdump();
-            emulator->available().at(i)->invoke();
+                h.rdump();
+            if (trace != nullptr)
+            {
+                trace->choices.push_back(i);
+                trace->steps.push_back(h.name);
+            }
+            h.invoke();
         }
         CLOG("done exec");
     }
 
-    void checkVariant(const Variant& v)
+    // resumes from the snapshot if it belongs to the world of the worker,
+    // the sleep set of the branch is updated by the last step
+    void execBranch(Branch& b)
     {
-        execVariant(v);
-        onEnd();
+        size_t from = 0;
+        if (b.snapshot && b.snapshot->isLocal())
+        {
+            CLOG("executing variant from snapshot: " << b.variant);
+            emulator->restore(*b.snapshot);
+            from = b.snapshot->depth;
+        }
+        else
+        {
+            CLOG("executing variant from scratch: " << b.variant);
+            init();
+        }
+        Footprint last;
+        for (size_t i = from; i < b.variant.size(); ++ i)
+            last = invoke(*emulator->available().at(b.variant[i]));
+        if (!b.sleep.empty())
+            b.sleep = awake(b.sleep, last);
+        CLOG("done exec");
     }
     
-protected:
-    bool allowedDisconnection()
+    // invokes the handler and collects its footprint
+    Footprint invoke(NodeHandler& h)
     {
-        return stats->disconnects < config->maxFailedNodes;
+        Footprint f{h};
+        h.invoke();
+        for (auto it = handlers->rbegin(); it != handlers->rend() && it->creator == stats->steps; ++ it)
+        {
+            VERIFY(it->context.currentNode < 64, "Footprint supports up to 64 nodes");
+            f.sends |= uint64_t(1) << it->context.currentNode;
+        }
+        return f;
     }
 
-    int fails = 0;
-    Handler onEnd;
-    An<Emulator> emulator;
-    An<Stats> stats;
-    An<GlobalStats> globalStats;
-    An<Config> config;
-    An<Variants> variants;
-};
-
-struct TrueScheduler : Scheduler
-{
-    using Scheduler::Scheduler;
+    void checkVariant(const Variant& v)
+    {
+        execVariant(v);
+        onEnd();
+    }
     
-    Variant runIteration(Variant v)
+    // replays the recorded traces, the world must be built by the same config
+    void replay(const std::string& path)
     {
-        while (true)
+        TraceReader reader{path};
+        Trace t;
+        int count = 0;
+        while (reader.read(t))
         {
-            if (int(v.size()) >= config->maxSteps)
+            t.verifyConfig(*config);
+            RLOG("Replaying trace #" << ++ count << ": " << t.choices);
+            execTrace(t);
+            try
             {
-                RLOG("Iteration exceeds the amount of steps: " << v);
-                break;
+                onEnd();
+                RLOG("Trace is not reproduced");
             }
-            //emulator->printAvailable();
+            catch (VerificationFail&)
+            {
+                RLOG("Trace is reproduced");
+            }
+        }
+        RLOG("replayed traces: " << count);
+    }
+    
+    // the handler is found by its name if the choice refers to another one
+    void execTrace(const Trace& t)
+    {
+        init();
+        for (size_t i = 0; i < t.steps.size(); ++ i)
+        {
             auto available = emulator->available();
-            if (available.empty())
-                break;
-            int ni = -1;
-            for (size_t i = 0; i < available.size(); ++ i)
+            const TraceStep& s = t.steps[i];
+            NodeHandler* h = t.choices[i] < int(available.size()) ? available[t.choices[i]] : nullptr;
+            if (h == nullptr || !s.matches(h->name))
             {
-                if (available[i]->type == EventType::Trigger)
+                h = nullptr;
+                for (NodeHandler* a: available)
                 {
-                    if (ni == -1)
+                    if (s.matches(a->name))
                     {
-                        ni = i;
+                        h = a;
+                        break;
                     }
-                    else
+                }
+                VERIFY(h != nullptr, "Handler of the trace step is not available");
+                RLOG("Choice is found by the handler name: " << s);
+            }
+            h->rdump();
+            h->invoke();
+        }
+    }
+    
+protected:
+    bool allowedDisconnection()
+    {
+        return stats->disconnects < config->maxFailedNodes;
+    }
+    
+    // there are handlers to invoke in the current state
+    bool movable()
+    {
+        for (auto&& h: emulator->available())
+            if (h->type == EventType::Trigger || allowedDisconnection())
+                return true;
+        return false;
+    }
+    
+    // the variant reached the depth of the level is continued on the next level
+    bool limited(const Branch& b, const SleepSet& sleep)
+    {
+        const Variant& v = b.variant;
+        if (limit == 0 || int(v.size()) < limit || !movable())
+            return false;
+        CLOG("variant reached the level: " << v);
+        if (config->frontier == Frontier::Breadth)
+            variants.defer(extendPrefix(b.prefix, v), -1, sleep, b.deviations);
+        else
+            cut = true;
+        return true;
+    }
+    
+    // the deepening level replays the shorter variants checked by the previous level:
+    // the variant of its depth is continued there if the handlers may be invoked
+    bool checked(const Variant& v)
+    {
+        if (config->frontier != Frontier::Deepening || limit <= config->levelSteps)
+            return false;
+        const int previous = limit - config->levelSteps;
+        return int(v.size()) < previous || (int(v.size()) == previous && !movable());
+    }
+    
+    void initVisited()
+    {
+        visitedStates.init(config->visitedStates);
+        bitStates.init(config->bitstateBits, config->bitstateHashes);
+    }
+    
+    // snapshot of the state reached by the variant, shared among its extents
+    SnapshotPtr snapshot(const Variant& v)
+    {
+        if (!config->snapshots)
+            return {};
+        auto s = std::make_shared<Snapshot>(emulator->save());
+        s->depth = v.size();
+        return s;
+    }
+    
+    // stateful exploration: true if the current state is already expanded
+    bool visited(const Variant& v)
+    {
+        if (!config->stateful())
+            return false;
+        const size_t hash = emulator->hash();
+        if (config->bitstateBits != 0 ? !bitStates.visit(hash) : !visitedStates.visit(hash, v.size()))
+            return false;
+        CLOG("state is already visited: " << v);
+        ++ globalStats->pruned;
+        return true;
+    }
+
+    std::atomic<int> fails{0};
+    int limit = 0; // depth of the current level, 0: unbounded
+    std::atomic<bool> cut{false}; // the deepening level has variants to continue
+    Handler onEnd;
+    TraceWriter traces;
+    Variants variants;
+    VisitedStates visitedStates;
+    BitStates bitStates;
+    An<Emulator> emulator;
+    An<Handlers> handlers;
+    An<Stats> stats;
+    Shared<GlobalStats> globalStats;
+    An<Config> config;
+};
+
+/*
+ * Explores all variants: the first trigger is invoked while the other
+ * available handlers are added as the variants to explore.
+ * Sleep sets mode: the invoked handler is put to sleep for its siblings
+ * and stays asleep until the dependent handler is invoked.
+ */
+struct TrueScheduler : Scheduler
+{
+    using Scheduler::Scheduler;
+    
+    bool runIteration(Branch& b) override
+    {
+        Variant& v = b.variant;
+        SleepSet sleep = std::move(b.sleep);
+        while (true)
+        {
+            if (int(v.size()) >= config->maxSteps)
+            {
+                RLOG("Iteration exceeds the amount of steps: " << v);
+                break;
+            }
+            if (limited(b, sleep))
+                return false;
+            if (visited(v))
+                return false;
+            //emulator->printAvailable();
+            auto available = emulator->available();
+            if (available.empty())
+                break;
+            int ni = -1;
+            bool blocked = false;
+            std::vector<Extent> extents;
+            for (size_t i = 0; i < available.size(); ++ i)
+            {
+                if (asleep(sleep, *available[i]))
+                {
+                    CLOG("asleep: " << available[i]->name);
+                    blocked |= available[i]->type == EventType::Trigger;
+                    continue;
+                }
+                Deviations d = b.deviations;
+                if (available[i]->type == EventType::Trigger)
+                {
+                    if (ni == -1)
                     {
-                        variants->addExtent(v, i);
+                        ni = i;
+                        continue;
                     }
+                    ++ d.preemptions;
                 }
                 else
                 {
-                    if (allowedDisconnection())
-                        variants->addExtent(v, i);
+                    if (!allowedDisconnection())
+                        continue;
+                    ++ d.faults;
                 }
+                extents.push_back({int(i), d});
+            }
+            SnapshotPtr branchPoint;
+            if (!extents.empty())
+            {
+                branchPoint = snapshot(v);
+                b.prefix = extendPrefix(b.prefix, v);
             }
             if (ni == -1)
             {
+                addExtents(b.prefix, extents, branchPoint, sleep);
+                if (blocked)
+                {
+                    CLOG("all triggers are asleep: " << v);
+                    return false;
+                }
                 // no any moves
                 break;
             }
+            int64_t id = available[ni]->id;
+            Footprint footprint = invoke(*available[ni]);
+            if (config->sleepSets)
+            {
+                SleepSet explored = sleep;
+                explored.push_back({id, footprint});
+                addExtents(b.prefix, extents, branchPoint, explored);
+                sleep = awake(sleep, footprint);
+            }
+            else
+            {
+                addExtents(b.prefix, extents, branchPoint, {});
+            }
+            v.push_back(ni);
+        }
+        CLOG("runIteration done");
+        return true;
+    }
+    
+protected:
+    // alternative choice and the deviations of the variant extended by it
+    struct Extent
+    {
+        int index;
+        Deviations deviations;
+    };
+    
+    virtual void addExtent(const PrefixPtr& prefix, const Extent& e, const SnapshotPtr& branchPoint, const SleepSet& sleep)
+    {
+        variants.addExtent(prefix, e.index, branchPoint, sleep, e.deviations);
+    }
+    
+private:
+    void addExtents(const PrefixPtr& prefix, const std::vector<Extent>& extents, const SnapshotPtr& branchPoint, const SleepSet& sleep)
+    {
+        for (auto&& e: extents)
+            addExtent(prefix, e, branchPoint, sleep);
+    }
+    
+    static bool asleep(const SleepSet& sleep, const NodeHandler& h)
+    {
+        for (auto&& s: sleep)
+            if (s.id == h.id)
+                return true;
+        return false;
+    }
+};
+
+/*
+ * Explores the variants by the bound of the deviations from the first
+ * trigger path: the level K explores the variants with at most K
+ * preemptions and K faults. The extent exceeding the bound is deferred
+ * to the next level thus each variant is explored once while the bound
+ * is raised step by step.
+ */
+struct BoundedScheduler : TrueScheduler
+{
+    using TrueScheduler::TrueScheduler;
+    
+    void run() override
+    {
+        VERIFY(!config->stateful(), "Bounded exploration is stateless: visited states ignore the bound");
+        VERIFY(config->frontier == Frontier::Depth, "Bounded exploration uses the depth frontier");
+        variants.init(std::max(config->threads, 1), config->spillVariants);
+        variants.attach(0);
+        variants.addRoot();
+        for (bound = 0; config->maxBound == 0 || bound <= config->maxBound; ++ bound)
+        {
+            int64_t iterations = globalStats->iterations;
+            explore();
+            if (variants.isStopped())
+                break;
+            int64_t deferred = variants.nextLevel();
+            RLOG("bound " << bound << ": variants: " << globalStats->iterations - iterations
+                << ", deferred: " << deferred);
+            if (deferred == 0)
+                break;
+        }
+        RLOG("global stats: " << *globalStats);
+    }
+    
+protected:
+    void addExtent(const PrefixPtr& prefix, const Extent& e, const SnapshotPtr& branchPoint, const SleepSet& sleep) override
+    {
+        if (e.deviations.preemptions <= bound && e.deviations.faults <= bound)
+            TrueScheduler::addExtent(prefix, e, branchPoint, sleep);
+        else
+            variants.defer(prefix, e.index, sleep, e.deviations);
+    }
+    
+private:
+    int bound = 0;
+};
+
+/*
+ * Stateless dynamic partial-order reduction with sleep sets
+ * (Flanagan, Godefroid 2005). Actor is the handler queue of the process
+ * or the node disconnection, handlers of the actor are invoked in order.
+ * Happens-before relation is tracked by vector clocks: the handler follows
+ * the dependent handlers invoked before it and the handler it is created by.
+ * The alternative actor is explored only where dependent handlers race.
+ * The footprint is known after the invocation thus the races of the handler
+ * are checked on its invocation for all the states it is the next handler
+ * of its actor like next(s, p) of the algorithm. The disconnection races
+ * with every handler because all nodes are notified. It drops the handlers
+ * of its node as well: they race with the disconnection because they are
+ * never invoked after it. The explored actors sleep for the siblings like in TrueScheduler,
+ * the variants are resumed from the snapshots of the branch points.
+ */
+struct DporScheduler : Scheduler
+{
+    using Scheduler::Scheduler;
+    
+    void run() override
+    {
+        VERIFY(!config->sleepSets, "DPOR uses its own sleep sets");
+        VERIFY(!config->stateful(), "DPOR is stateless");
+        VERIFY(config->frontier == Frontier::Depth, "DPOR uses the depth frontier");
+        if (config->threads > 1)
+            RLOG("DPOR uses single thread");
+        init();
+        queuesCount = queues->size();
+        actorsCount = queuesCount + nodes->size();
+        used = 0;
+        next = -1;
+        Branch b;
+        Variant& v = b.variant;
+        while (true)
+        {
+            int64_t i = ++ globalStats->iterations;
+            if (config->maxIterations != 0 && i > config->maxIterations)
+            {
+                -- globalStats->iterations;
+                break;
+            }
+            if (runIteration(b) && finalize(v))
+                break;
+            if (i % config->progressIterations == 0)
+            {
+                RLOG("global stats: " << *globalStats);
+                RLOG("Variant: " << v);
+            }
+            if (!backtrack(v))
+            {
+                CLOG("no variants");
+                break;
+            }
+        }
+        RLOG("global stats: " << *globalStats);
+    }
+    
+    // continues the variant from the current state
+    bool runIteration(Branch& b) override
+    {
+        Variant& v = b.variant;
+        while (true)
+        {
+            const size_t depth = v.size();
+            auto available = emulator->available();
+            if (int(depth) >= config->maxSteps)
+            {
+                RLOG("Iteration exceeds the amount of steps: " << v);
+                addPendingRaces(available, depth, nullptr);
+                break;
+            }
+            if (used == depth)
+                pushFrame(available, v);
+            Frame& f = frames[depth];
+            for (NodeHandler* h: available)
+            {
+                const int actor = actorOf(*h);
+                if (h->type == EventType::Disconnect && contains(f.enabled, actor))
+                {
+                    clock(depth, actor, *h, pending);
+                    addRaces(depth, actor, Footprint{*h}, pending, depth);
+                }
+            }
+            bool blocked = false;
+            int ni = chooseActor(f, available, blocked);
+            if (ni == -1)
+            {
+                addPendingRaces(available, depth, &f);
+                if (blocked)
+                {
+                    CLOG("all triggers are asleep: " << v);
+                    return false;
+                }
+                break; // no any moves
+            }
+            NodeHandler& h = *available[ni];
+            const int actor = actorOf(h);
+            if (h.type == EventType::Disconnect)
+                addDropped(f, available, h.context.currentNode);
+            clock(depth, actor, h, pending);
+            const size_t from = nextFrom(depth, actor, h);
+            f.actor = actor;
+            f.id = h.id;
+            v.push_back(ni);
+            f.footprint = invoke(h);
+            addRaces(depth, actor, f.footprint, pending, from);
+            f.clock = pending;
+            for (size_t i = 0; i < depth; ++ i)
+                if (frames[i].footprint.dependent(f.footprint))
+                    join(f.clock, frames[i].clock);
+            f.clock[actor] = depth + 1;
+        }
+        CLOG("runIteration done");
+        return true;
+    }
+    
+private:
+    using Clock = std::vector<int64_t>;
+    
+    // state of the variant, the frames are reused to avoid allocations
+    struct Frame
+    {
+        std::vector<int> enabled;   // actors that may be invoked
+        std::vector<int64_t> ids;   // their next handlers
+        std::vector<int> backtrack;
+        std::vector<int> done;
+        SleepSet sleep;
+        SnapshotPtr snapshot;       // the state of the branch point
+        
+        // invoked handler
+        int actor = -1;
+        int64_t id = 0;
+        Footprint footprint;
+        Clock clock;
+    };
+    
+    static bool contains(const std::vector<int>& actors, int actor)
+    {
+        return std::find(actors.begin(), actors.end(), actor) != actors.end();
+    }
+    
+    static void insert(std::vector<int>& actors, int actor)
+    {
+        if (!contains(actors, actor))
+            actors.push_back(actor);
+    }
+    
+    int actorOf(const NodeHandler& h) const
+    {
+        if (h.type == EventType::Disconnect)
+            return queuesCount + h.context.currentNode;
+        VERIFY(h.owner != nullptr && h.owner->index != -1, "Trigger must be queued");
+        return h.owner->index;
+    }
+    
+    void pushFrame(const Available& available, const Variant& v)
+    {
+        if (frames.size() == used)
+            frames.emplace_back();
+        Frame& f = frames[used ++];
+        f.enabled.clear();
+        f.ids.clear();
+        f.backtrack.clear();
+        f.done.clear();
+        f.sleep.clear();
+        f.actor = -1;
+        for (NodeHandler* h: available)
+        {
+            if (h->type == EventType::Trigger || allowedDisconnection())
+            {
+                f.enabled.push_back(actorOf(*h));
+                f.ids.push_back(h->id);
+            }
+        }
+        if (used > 1)
+        {
+            const Frame& parent = frames[used - 2];
+            for (auto&& s: parent.sleep)
+                if (!s.footprint.dependent(parent.footprint))
+                    f.sleep.push_back(s);
+        }
+        f.snapshot = f.enabled.size() > 1 ? snapshot(v) : SnapshotPtr{};
+    }
+    
+    const Sleeper* asleep(const Frame& f, int64_t id) const
+    {
+        for (auto&& s: f.sleep)
+            if (s.id == id)
+                return &s;
+        return nullptr;
+    }
+    
+    bool asleep(const Frame& f, int actor) const
+    {
+        auto it = std::find(f.enabled.begin(), f.enabled.end(), actor);
+        return it != f.enabled.end() && asleep(f, f.ids[it - f.enabled.begin()]) != nullptr;
+    }
+    
+    // uses the requested actor or the first awake trigger like TrueScheduler does,
+    // the final state explores disconnections because they are optional
+    int chooseActor(Frame& f, const Available& available, bool& blocked)
+    {
+        int actor = next;
+        next = -1;
+        for (size_t i = 0; i < available.size(); ++ i)
+        {
+            NodeHandler& h = *available[i];
+            if (actor != -1)
+            {
+                if (actorOf(h) != actor)
+                    continue;
+            }
+            else if (h.type != EventType::Trigger)
+            {
+                continue;
+            }
+            else if (asleep(f, h.id) != nullptr)
+            {
+                blocked = true;
+                continue;
+            }
+            actor = actorOf(h);
+            insert(f.backtrack, actor);
+            insert(f.done, actor);
+            return i;
+        }
+        VERIFY(actor == -1, "Actor must be available");
+        for (int a: f.enabled)
+            insert(f.backtrack, a);
+        return -1;
+    }
+    
+    static void join(Clock& c, const Clock& other)
+    {
+        for (size_t i = 0; i < other.size(); ++ i)
+            c[i] = std::max(c[i], other[i]);
+    }
+    
+    // vector clock of the next handler of the actor on the depth
+    void clock(size_t depth, int actor, const NodeHandler& h, Clock& c)
+    {
+        c.assign(actorsCount, 0);
+        for (size_t i = depth; i -- > 0;)
+        {
+            if (frames[i].actor == actor)
+            {
+                join(c, frames[i].clock);
+                break;
+            }
+        }
+        if (h.creator > 0)
+            join(c, frames[h.creator - 1].clock);
+    }
+    
+    // the first state the handler is the next one of its actor on
+    size_t nextFrom(size_t depth, int actor, const NodeHandler& h) const
+    {
+        const size_t created = size_t(h.creator);
+        for (size_t i = depth; i -- > created;)
+            if (frames[i].actor == actor)
+                return i + 1;
+        return created;
+    }
+    
+    // adds the backtrack points for the dependent handlers not happened before
+    // the handler of the actor: all the races since the handler is the next one
+    // of the actor on the depth `from` and the last race before
+    void addRaces(size_t depth, int actor, const Footprint& footprint, const Clock& c, size_t from)
+    {
+        for (size_t i = depth; i -- > 0;)
+        {
+            Frame& f = frames[i];
+            if (f.actor == actor || c[f.actor] >= int64_t(i + 1))
+                continue; // happens before
+            if (!f.footprint.dependent(footprint))
+                continue; // independent
+            if (contains(f.enabled, actor))
+            {
+                insert(f.backtrack, actor);
+            }
+            else
+            {
+                for (int a: f.enabled)
+                    insert(f.backtrack, a);
+            }
+            CLOG("race: " << i << " and actor " << actor << " on depth " << depth);
+            if (i < from)
+                break;
+        }
+    }
+    
+    // the handler that is not invoked: the asleep one has the footprint
+    // it is explored with, otherwise it may send to any node
+    Footprint pendingFootprint(const Frame* f, const NodeHandler& h) const
+    {
+        if (const Sleeper* s = f != nullptr ? asleep(*f, h.id) : nullptr)
+            return s->footprint;
+        Footprint footprint{h};
+        footprint.sends = ~uint64_t(0);
+        return footprint;
+    }
+    
+    // races of the handlers that are not invoked at the end of the variant
+    void addPendingRaces(const Available& available, size_t depth, const Frame* f)
+    {
+        for (NodeHandler* h: available)
+        {
+            if (h->type != EventType::Trigger)
+                continue;
+            const int actor = actorOf(*h);
+            clock(depth, actor, *h, pending);
+            addRaces(depth, actor, pendingFootprint(f, *h), pending, nextFrom(depth, actor, *h));
+        }
+    }
+    
+    // the handlers of the disconnected node are dropped: the actors are explored
+    // before the disconnection
+    void addDropped(Frame& f, const Available& available, int node)
+    {
+        for (NodeHandler* h: available)
+            if (h->type == EventType::Trigger && h->context.currentNode == node)
+                insert(f.backtrack, actorOf(*h));
+    }
+    
+    // the next alternative of the deepest frame, the explored actor sleeps for it
+    bool backtrack(Variant& v)
+    {
+        while (used > 0)
+        {
+            Frame& f = frames[used - 1];
+            if (f.actor != -1)
+            {
+                f.sleep.push_back({f.id, f.footprint});
+                f.actor = -1;
+            }
+            for (int a: f.backtrack)
+            {
+                if (contains(f.done, a) || asleep(f, a))
+                    continue;
+                next = a;
+                v.resize(used - 1);
+                restore(v);
+                return true;
+            }
+            f.snapshot.reset();
+            -- used;
+        }
+        return false;
+    }
+    
+    // resumes the variant from the nearest branch point
+    void restore(const Variant& v)
+    {
+        size_t from = v.size();
+        while (from > 0 && !frames[from].snapshot)
+            -- from;
+        if (frames[from].snapshot)
+        {
+            CLOG("executing variant from snapshot: " << v);
+            emulator->restore(*frames[from].snapshot);
+        }
+        else
+        {
+            CLOG("executing variant from scratch: " << v);
+            init();
+        }
+        for (size_t i = from; i < v.size(); ++ i)
+            emulator->available().at(v[i])->invoke();
+    }
+    
+    std::vector<Frame> frames;
+    size_t used = 0; // frames of the current variant
+    int next = -1;
+    int queuesCount = 0;
+    int actorsCount = 0;
+    Clock pending; // clock of the handler to be invoked
+    An<Queues> queues;
+    An<Nodes> nodes;
+};
+
+/*
+ * Random walks for the configurations that cannot be explored exhaustively.
+ * Each walk picks the available handlers uniformly or by the weight,
+ * the random generator of the walk is seeded by the seed and the walk
+ * index thus the walks do not depend on the threads. Swarm mode restricts
+ * each walk to a random subset of the unreliable nodes and a random amount
+ * of failures: the variant still refers to the handlers available under
+ * the original config thus the failed variant is reproduced by checkVariant.
+ */
+struct RandomScheduler : Scheduler
+{
+    using Weight = std::function<double(const NodeHandler&)>;
+    
+    using Scheduler::Scheduler;
+    
+    void run() override
+    {
+        stopped = false;
+        start = std::chrono::steady_clock::now();
+        Workers().run(config->threads, [this](int) {
+            walk();
+        });
+        RLOG("global stats: " << *globalStats);
+    }
+    
+    bool runIteration(Branch& b) override
+    {
+        Variant& v = b.variant;
+        std::vector<int> choices;
+        std::vector<double> weights;
+        while (true)
+        {
+            if (int(v.size()) >= config->maxSteps)
+            {
+                RLOG("Iteration exceeds the amount of steps: " << v);
+                break;
+            }
+            auto available = emulator->available();
+            choices.clear();
+            weights.clear();
+            for (size_t i = 0; i < available.size(); ++ i)
+            {
+                const NodeHandler& h = *available[i];
+                if (h.type != EventType::Trigger && !failable(h.context.currentNode))
+                    continue;
+                choices.push_back(i);
+                if (weight)
+                    weights.push_back(weight(h));
+            }
+            if (choices.empty())
+                break; // no any moves
+            int ni = choices[choose(weights, choices.size())];
             v.push_back(ni);
             available[ni]->invoke();
         }
         CLOG("runIteration done");
-        return v;
+        return true;
+    }
+    
+    Weight weight; // uniform choice if empty
+    
+private:
+    void walk()
+    {
+        Branch b;
+        while (!stopped)
+        {
+            int64_t i = ++ globalStats->iterations;
+            if (bounded(i))
+            {
+                -- globalStats->iterations;
+                break;
+            }
+            current().random.seed(hashMix(config->seed + i));
+            initSwarm();
+            b.variant.clear();
+            init();
+            if (runIteration(b) && finalize(b.variant))
+            {
+                stopped = true;
+                break;
+            }
+            if (i % config->progressIterations == 0)
+            {
+                RLOG("global stats: " << *globalStats);
+                RLOG("Variant: " << b.variant);
+            }
+        }
     }
+    
+    bool bounded(int64_t iteration) const
+    {
+        if (config->maxIterations != 0 && iteration > config->maxIterations)
+            return true;
+        return config->maxSeconds != 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > config->maxSeconds;
+    }
+    
+    void initSwarm()
+    {
+        Walk& w = current();
+        w.failing = ~uint64_t(0);
+        w.maxFailed = config->maxFailedNodes;
+        if (!config->swarm)
+            return;
+        w.failing = w.random();
+        w.maxFailed = std::uniform_int_distribution<int>(0, config->maxFailedNodes)(w.random);
+        CLOG("swarm failing nodes: " << w.failing << ", max failed: " << w.maxFailed);
+    }
+    
+    bool failable(int node)
+    {
+        VERIFY(node < 64, "Swarm supports up to 64 nodes");
+        const Walk& w = current();
+        return stats->disconnects < w.maxFailed && (w.failing >> node & 1) != 0;
+    }
+    
+    int choose(const std::vector<double>& weights, size_t count)
+    {
+        if (weights.empty())
+            return std::uniform_int_distribution<int>(0, count - 1)(current().random);
+        double total = 0;
+        for (double w: weights)
+            total += w;
+        double r = std::uniform_real_distribution<double>(0, total)(current().random);
+        for (size_t i = 0; i + 1 < count; ++ i)
+        {
+            r -= weights[i];
+            if (r < 0)
+                return i;
+        }
+        return count - 1;
+    }
+    
+    // the walk belongs to the worker thread
+    struct Walk
+    {
+        std::mt19937_64 random;
+        uint64_t failing = ~uint64_t(0); // swarm: nodes that may fail
+        int maxFailed = 0;
+    };
+    
+    static Walk& current()
+    {
+        return single<Walk, RandomScheduler>();
+    }
+    
+    std::atomic<bool> stopped{false};
+    std::chrono::steady_clock::time_point start;
 };
@@ -43,43 +43,47 @@ template<typename T_service, typename... T_delegateMessage>
 struct Service : Delegate<T_delegateMessage>...
 {
     template<typename T_dstService, typename T_msg>
-    bool trigger(int dstNode, const T_msg& msg)
+    bool trigger(int dstNode, T_msg&& msg)
     {
-        return emulator->trigger<T_dstService>(dstNode, msg);
+        return emulator->trigger<T_dstService>(dstNode, std::forward<T_msg>(msg));
     }
     
     template<typename T_dstService, typename T_msg>
-    bool trigger(const T_msg& msg)
+    bool trigger(T_msg&& msg)
     {
-        return emulator->trigger<T_dstService>(context().currentNode, msg);
+        return emulator->trigger<T_dstService>(context().currentNode, std::forward<T_msg>(msg));
     }
     
+    // the destinations share the message
     template<typename T_dstService, typename T_msg>
-    int triggerAny(const T_msg& msg, int count = 1)
+    int triggerAny(T_msg&& msg, int count = 1)
     {
+        auto shared = payload(std::forward<T_msg>(msg));
         int triggerCount = 0;
         for (size_t i = 0; i < nodes->size(); ++ i)
-            if (this->trigger<T_dstService>(i, msg))
+            if (emulator->template triggerPayload<T_dstService>(i, shared))
                 if (++ triggerCount == count)
                     break;
         return triggerCount;
     }
 
+    // the destinations share the message
     template<typename T_dstService, typename T_msg>
-    int triggerAllExceptSelf(const T_msg& msg)
+    int triggerAllExceptSelf(T_msg&& msg)
     {
+        auto shared = payload(std::forward<T_msg>(msg));
         int triggerCount = 0;
         for (size_t i = 0; i < nodes->size(); ++ i)
             if (i != context().currentNode)
-                if (this->trigger<T_dstService>(i, msg))
+                if (emulator->template triggerPayload<T_dstService>(i, shared))
                     ++ triggerCount;
         return triggerCount;
     }
 
     template<typename T_dstService, typename T_msg>
-    int triggerAll(const T_msg& msg)
+    int triggerAll(T_msg&& msg)
     {
-        return this->triggerAny<T_dstService>(msg, -1);
+        return this->triggerAny<T_dstService>(std::forward<T_msg>(msg), -1);
     }
 
     template<typename... T>
@@ -89,9 +93,9 @@ struct Service : Delegate<T_delegateMessage>...
     }
 
     template<typename T_msg>
-    void broadcast(const T_msg& msg)
+    void broadcast(T_msg&& msg)
     {
-        triggerAllExceptSelf<T_service>(msg);
+        triggerAllExceptSelf<T_service>(std::forward<T_msg>(msg));
     }
 
     template<typename T_localService>
@@ -148,8 +152,13 @@ struct ServiceCreator
     template<typename T_service>
     void create(int node, int nodeCount = 1)
     {
-        for (int i = 0; i < nodeCount; ++ i)
-            nodes->sizedNode(node + i).addProcess<T_service>();
+        Handler step = [node, nodeCount] {
+            An<Nodes> nodes;
+            for (int i = 0; i < nodeCount; ++ i)
+                nodes->sizedNode(node + i).addProcess<T_service>();
+        };
+        step();
+        blueprint->add(std::move(step));
     }
 
     Config& config()
@@ -158,8 +167,8 @@ struct ServiceCreator
     }
 
 private:
-    An<Nodes> nodes;
     An<Config> conf;
+    An<Blueprint> blueprint;
 };
 
 #define SLOG(D_msg)         JLOG("SRV: " << D_msg << ", on " << context().sourceNode << "=>" << context().currentNode)
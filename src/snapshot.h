@@ -0,0 +1,51 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+struct ProcessState
+{
+    std::shared_ptr<void> service; // copy of the service object
+    std::vector<NodeHandler> handlers;
+};
+
+struct NodeState
+{
+    bool on;
+    std::vector<ProcessState> processes;
+};
+
+/*
+ * State of the whole emulated world of the current thread.
+ * Handlers and services may refer to the objects of the world
+ * thus the snapshot can be restored only within the same world.
+ */
+struct Snapshot
+{
+    std::vector<NodeState> nodes;
+    std::vector<NodeHandler> disconnects;
+    Stats stats;
+    Context context;
+    Ids ids;
+
+    size_t depth = 0; // variant steps to reach the state
+    std::thread::id world = std::this_thread::get_id();
+
+    bool isLocal() const
+    {
+        return world == std::this_thread::get_id();
+    }
+};
+
+using SnapshotPtr = std::shared_ptr<const Snapshot>;
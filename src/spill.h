@@ -0,0 +1,125 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stack of the data chunks in the temporary file on local disk:
+ * the last written chunk is read first and its space is reused
+ * by the next chunk thus the file does not outgrow the spilled data.
+ */
+struct ChunkStack
+{
+    ChunkStack() = default;
+    ChunkStack(const ChunkStack&) = delete;
+    ChunkStack& operator=(const ChunkStack&) = delete;
+
+    ~ChunkStack()
+    {
+        if (file != nullptr)
+            std::fclose(file);
+    }
+
+    void push(const std::string& data)
+    {
+        if (file == nullptr)
+        {
+            file = std::tmpfile();
+            VERIFY(file != nullptr, "Cannot create the spill file");
+        }
+        long offset = chunks.empty() ? 0 : chunks.back().offset + chunks.back().size;
+        VERIFY(std::fseek(file, offset, SEEK_SET) == 0, "Cannot seek the spill file");
+        VERIFY(std::fwrite(data.data(), 1, data.size(), file) == data.size(), "Cannot write the spill file");
+        chunks.push_back({offset, long(data.size())});
+    }
+
+    std::string pop()
+    {
+        VERIFY(!chunks.empty(), "No spilled chunks");
+        Chunk c = chunks.back();
+        chunks.pop_back();
+        std::string data(c.size, '\0');
+        VERIFY(std::fseek(file, c.offset, SEEK_SET) == 0, "Cannot seek the spill file");
+        VERIFY(std::fread(&data[0], 1, data.size(), file) == data.size(), "Cannot read the spill file");
+        return data;
+    }
+
+    bool empty() const
+    {
+        return chunks.empty();
+    }
+
+private:
+    struct Chunk
+    {
+        long offset;
+        long size;
+    };
+
+    std::FILE* file = nullptr;
+    std::vector<Chunk> chunks;
+};
+
+// plain values serialization for the chunks
+struct ChunkWriter
+{
+    template<typename T>
+    void put(const T& t)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Value must be trivially copyable");
+        data.append(reinterpret_cast<const char*>(&t), sizeof(t));
+    }
+
+    void putString(const std::string& s)
+    {
+        put(uint32_t(s.size()));
+        data.append(s);
+    }
+
+    std::string data;
+};
+
+struct ChunkReader
+{
+    explicit ChunkReader(const std::string& chunk) : data(chunk) {}
+
+    template<typename T>
+    T get()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Value must be trivially copyable");
+        VERIFY(pos + sizeof(T) <= data.size(), "Chunk is truncated");
+        T t;
+        std::memcpy(&t, data.data() + pos, sizeof(t));
+        pos += sizeof(t);
+        return t;
+    }
+
+    std::string getString()
+    {
+        size_t size = get<uint32_t>();
+        VERIFY(pos + size <= data.size(), "Chunk is truncated");
+        std::string s = data.substr(pos, size);
+        pos += size;
+        return s;
+    }
+
+    bool atEnd() const
+    {
+        return pos == data.size();
+    }
+
+private:
+    const std::string& data;
+    size_t pos = 0;
+};
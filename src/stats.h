@@ -14,18 +14,25 @@
  * limitations under the License.
  */
 
+// shared among worker threads
 struct GlobalStats
 {
-    int64_t iterations = 0;
-    int64_t disconnects = 0;
+    std::atomic<int64_t> iterations{0};
+    std::atomic<int64_t> disconnects{0};
+    std::atomic<int64_t> pruned{0};
 };
 
 struct Stats : Initer<Stats>
 {
     int64_t disconnects = 0;
+    int64_t steps = 0; // invoked handlers
+    int64_t handlers = 0; // created handlers
 };
 
 inline std::ostream& operator<<(std::ostream& o, const GlobalStats& s)
 {
-    return o << "iterations: " << s.iterations << ", disconnects: " << s.disconnects;
+    o << "iterations: " << s.iterations.load() << ", disconnects: " << s.disconnects.load();
+    if (s.pruned != 0)
+        o << ", pruned: " << s.pruned.load();
+    return o;
 }
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// handler invoked by the step: the type names and the nodes are stable
+// across the builds of the same code unlike the indices of the choices
+struct TraceStep
+{
+    std::string service; // empty: node disconnection
+    std::string message;
+    int sourceNode = -1;
+    int currentNode = -1;
+
+    TraceStep() = default;
+
+    TraceStep(const HandlerName& name)
+        : service(name.service ? *name.service : std::string()),
+          message(name.message ? *name.message : std::string()),
+          sourceNode(name.context.sourceNode), currentNode(name.context.currentNode)
+    {
+    }
+
+    bool matches(const HandlerName& name) const
+    {
+        return sourceNode == name.context.sourceNode && currentNode == name.context.currentNode &&
+            service == (name.service ? *name.service : std::string()) &&
+            message == (name.message ? *name.message : std::string());
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& o, const TraceStep& s)
+{
+    if (s.service.empty())
+        return o << "node disconnection: " << s.currentNode;
+    return o << s.service << "::" << s.message << " " << s.sourceNode << "=>" << s.currentNode;
+}
+
+/*
+ * Recorded execution: the config the world is built by, the verified
+ * algorithm, the choices of the available handlers and the handlers
+ * invoked by them.
+ */
+struct Trace
+{
+    std::string algorithm;
+    int nodes = 0;
+    int maxFailedNodes = 0;
+    int minUnreliableNode = 0;
+    int maxSteps = 0;
+    std::vector<int> choices;
+    std::vector<TraceStep> steps;
+
+    void setConfig(const Config& c)
+    {
+        algorithm = c.algorithm;
+        nodes = c.nodes;
+        maxFailedNodes = c.maxFailedNodes;
+        minUnreliableNode = c.minUnreliableNode;
+        maxSteps = c.maxSteps;
+    }
+
+    // the world must be built by the same config to replay the trace
+    void verifyConfig(const Config& c) const
+    {
+        VERIFY(algorithm == c.algorithm, "Trace is recorded for another algorithm");
+        VERIFY(nodes == c.nodes, "Trace is recorded for another number of nodes");
+        VERIFY(minUnreliableNode == c.minUnreliableNode, "Trace is recorded for other unreliable nodes");
+    }
+};
+
+/*
+ * Binary record of the trace: the type names are interned by the record
+ * and each step takes 7 bytes: the choice, the name indices and the nodes.
+ */
+inline std::string encode(const Trace& t)
+{
+    static constexpr uint16_t noName = 0xffff;
+    std::vector<const std::string*> names;
+    auto index = [&names](const std::string& name) {
+        if (name.empty())
+            return noName;
+        for (size_t i = 0; i < names.size(); ++ i)
+            if (*names[i] == name)
+                return uint16_t(i);
+        VERIFY(names.size() < noName, "Too many names in the trace");
+        names.push_back(&name);
+        return uint16_t(names.size() - 1);
+    };
+    VERIFY(t.choices.size() == t.steps.size(), "Each choice must have the step");
+    ChunkWriter steps;
+    for (size_t i = 0; i < t.choices.size(); ++ i)
+    {
+        const TraceStep& s = t.steps[i];
+        VERIFY(t.choices[i] >= 0 && t.choices[i] <= 0xff, "Choice index must fit the byte");
+        VERIFY(s.sourceNode >= -1 && s.sourceNode < 0x7f && s.currentNode >= -1 && s.currentNode < 0x7f,
+            "Node must fit the byte");
+        steps.put(uint8_t(t.choices[i]));
+        steps.put(index(s.service));
+        steps.put(index(s.message));
+        steps.put(int8_t(s.sourceNode));
+        steps.put(int8_t(s.currentNode));
+    }
+    ChunkWriter w;
+    w.putString(t.algorithm);
+    w.put(int32_t(t.nodes));
+    w.put(int32_t(t.maxFailedNodes));
+    w.put(int32_t(t.minUnreliableNode));
+    w.put(int32_t(t.maxSteps));
+    w.put(uint16_t(names.size()));
+    for (auto&& name: names)
+        w.putString(*name);
+    w.put(uint32_t(t.choices.size()));
+    w.data += steps.data;
+    return std::move(w.data);
+}
+
+inline Trace decode(const std::string& record)
+{
+    ChunkReader r{record};
+    Trace t;
+    t.algorithm = r.getString();
+    t.nodes = r.get<int32_t>();
+    t.maxFailedNodes = r.get<int32_t>();
+    t.minUnreliableNode = r.get<int32_t>();
+    t.maxSteps = r.get<int32_t>();
+    std::vector<std::string> names(r.get<uint16_t>());
+    for (auto&& name: names)
+        name = r.getString();
+    auto name = [&names](uint16_t i) {
+        if (i == 0xffff)
+            return std::string();
+        VERIFY(i < names.size(), "Invalid name index in the trace");
+        return names[i];
+    };
+    size_t count = r.get<uint32_t>();
+    for (size_t i = 0; i < count; ++ i)
+    {
+        t.choices.push_back(r.get<uint8_t>());
+        TraceStep s;
+        s.service = name(r.get<uint16_t>());
+        s.message = name(r.get<uint16_t>());
+        s.sourceNode = r.get<int8_t>();
+        s.currentNode = r.get<int8_t>();
+        t.steps.push_back(std::move(s));
+    }
+    VERIFY(r.atEnd(), "Invalid trace record");
+    return t;
+}
+
+static constexpr uint32_t traceMagic = 0x54564144; // "DAVT"
+static constexpr uint32_t traceVersion = 1;
+
+/*
+ * Appends the traces to the file: the header is followed by the records
+ * prefixed by their size thus the file of the previous runs is extended
+ * and the reader streams the records. Only failed executions are written,
+ * each record is flushed.
+ */
+struct TraceWriter
+{
+    TraceWriter() = default;
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    ~TraceWriter()
+    {
+        if (file != nullptr)
+            std::fclose(file);
+    }
+
+    void write(const std::string& path, const Trace& t)
+    {
+        std::string record = encode(t);
+        std::lock_guard<std::mutex> lock{mutex};
+        if (file == nullptr)
+            open(path);
+        uint32_t size = record.size();
+        VERIFY(std::fwrite(&size, sizeof(size), 1, file) == 1, "Cannot write the trace file");
+        VERIFY(std::fwrite(record.data(), 1, record.size(), file) == record.size(), "Cannot write the trace file");
+        std::fflush(file);
+    }
+
+private:
+    void open(const std::string& path)
+    {
+        file = std::fopen(path.c_str(), "ab");
+        VERIFY(file != nullptr, "Cannot open the trace file");
+        VERIFY(std::fseek(file, 0, SEEK_END) == 0, "Cannot seek the trace file");
+        if (std::ftell(file) != 0)
+            return;
+        ChunkWriter header;
+        header.put(traceMagic);
+        header.put(traceVersion);
+        VERIFY(std::fwrite(header.data.data(), 1, header.data.size(), file) == header.data.size(),
+            "Cannot write the trace file");
+    }
+
+    std::mutex mutex;
+    std::FILE* file = nullptr;
+};
+
+struct TraceReader
+{
+    explicit TraceReader(const std::string& path) : file(std::fopen(path.c_str(), "rb"))
+    {
+        VERIFY(file != nullptr, "Cannot open the trace file");
+        uint32_t header[2];
+        VERIFY(std::fread(header, sizeof(header), 1, file) == 1, "Trace file is truncated");
+        VERIFY(header[0] == traceMagic, "Invalid trace file");
+        VERIFY(header[1] == traceVersion, "Unsupported trace file version");
+    }
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    ~TraceReader()
+    {
+        std::fclose(file);
+    }
+
+    // returns false at the end of the file
+    bool read(Trace& t)
+    {
+        uint32_t size;
+        if (std::fread(&size, sizeof(size), 1, file) != 1)
+            return false;
+        std::string record(size, '\0');
+        VERIFY(std::fread(&record[0], 1, size, file) == size, "Trace file is truncated");
+        t = decode(record);
+        return true;
+    }
+
+private:
+    std::FILE* file;
+};
@@ -50,10 +50,12 @@ inline std::string demangle(const std::string& name)
 
 #endif
 
+// demangled once per type
 template<typename T>
-std::string getTypeName()
+const std::string& getTypeName()
 {
-    return demangle(typeid(T).name());
+    static const std::string name = demangle(typeid(T).name());
+    return name;
 }
 
 struct TypeContainer
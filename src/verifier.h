@@ -21,17 +21,41 @@
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <limits>
+#include <bitset>
 #include <set>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <type_traits>
 
 #include "helpers.h"
 #include "common.h"
 #include "context.h"
-#include "event.h"
+#include "stats.h"
 #include "type.h"
+#include "callable.h"
+#include "arena.h"
+#include "event.h"
+#include "hash.h"
 #include "queue.h"
+#include "snapshot.h"
 #include "node.h"
-#include "stats.h"
 #include "emulator.h"
+#include "world.h"
+#include "visited.h"
+#include "spill.h"
+#include "trace.h"
 #include "schedulers.h"
+#include "bitset.h"
 #include "service.h"
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Lock free table of the expanded state fingerprints shared among workers.
+ * Each entry keeps the fingerprint and the minimal depth the state
+ * was reached at: the state reached again deeper has less steps left
+ * thus it is already covered. The table never grows: the state that
+ * cannot be placed is just explored again.
+ */
+struct VisitedStates
+{
+    void init(int64_t size)
+    {
+        count = size;
+        entries.reset(size == 0 ? nullptr : new std::atomic<uint64_t>[size]());
+        stored = 0;
+    }
+
+    // returns true if the state was expanded at the same or less depth
+    bool visit(size_t hash, size_t depth)
+    {
+        const uint64_t fingerprint = (hash & ~depthMask) == 0 ? depthMask + 1 : hash & ~depthMask;
+        const uint64_t entry = fingerprint | (depth < depthMask ? depth : depthMask);
+        uint64_t index = (hash >> depthBits) % count;
+        for (int probe = 0; probe < maxProbes; ++ probe)
+        {
+            auto& e = entries[index];
+            uint64_t old = e.load(std::memory_order_relaxed);
+            while (true)
+            {
+                if (old == 0)
+                {
+                    if (e.compare_exchange_weak(old, entry))
+                    {
+                        ++ stored;
+                        return false;
+                    }
+                    continue;
+                }
+                if ((old & ~depthMask) != fingerprint)
+                    break;
+                if ((old & depthMask) <= (entry & depthMask))
+                    return true;
+                if (e.compare_exchange_weak(old, entry))
+                    return false;
+            }
+            if (++ index == uint64_t(count))
+                index = 0;
+        }
+        return false;
+    }
+
+    int64_t size() const
+    {
+        return stored;
+    }
+
+private:
+    static constexpr int depthBits = 8;
+    static constexpr uint64_t depthMask = (1 << depthBits) - 1;
+    static constexpr int maxProbes = 16;
+
+    int64_t count = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> entries;
+    std::atomic<int64_t> stored{0};
+};
+
+/*
+ * Bitstate (supertrace) table: the state is marked by k bits chosen by
+ * independent hashes of its fingerprint and is treated as expanded when all
+ * of its bits are set. The memory does not depend on the number of states
+ * but the state whose bits are set by the others is omitted. The depth is
+ * not kept thus the state reached again shallower is not expanded either.
+ */
+struct BitStates
+{
+    void init(int64_t bits, int hashes)
+    {
+        VERIFY(bits >= 0 && hashes > 0, "Invalid bitstate table parameters");
+        count = (bits + 63) / 64 * 64;
+        k = hashes;
+        words.reset(count == 0 ? nullptr : new std::atomic<uint64_t>[count / 64]());
+        stored = 0;
+        ones = 0;
+    }
+
+    // returns true if all the bits of the state are already set
+    bool visit(size_t hash)
+    {
+        // double hashing: i-th bit index is h1 + i * h2
+        const uint64_t h1 = hash;
+        const uint64_t h2 = hashMix(hash) | 1;
+        bool found = true;
+        for (int i = 0; i < k; ++ i)
+        {
+            const uint64_t bit = (h1 + i * h2) % count;
+            const uint64_t mask = uint64_t(1) << (bit % 64);
+            auto& w = words[bit / 64];
+            if (w.load(std::memory_order_relaxed) & mask)
+                continue;
+            if ((w.fetch_or(mask) & mask) == 0)
+            {
+                ++ ones;
+                found = false;
+            }
+        }
+        if (!found)
+            ++ stored;
+        return found;
+    }
+
+    int64_t size() const
+    {
+        return stored;
+    }
+
+    // probability that the next new state is taken as already expanded
+    double omissionProbability() const
+    {
+        return count == 0 ? 0 : std::pow(double(ones) / count, k);
+    }
+
+    // expected number of the states omitted while storing the current ones:
+    // the i-th state is omitted with probability (1 - exp(-k*i/m))^k
+    double expectedOmissions() const
+    {
+        const int segments = 1024;
+        const double n = double(stored);
+        double sum = 0;
+        for (int i = 0; i < segments; ++ i)
+        {
+            const double x = n * (i + 0.5) / segments;
+            sum += std::pow(1 - std::exp(-k * x / count), k);
+        }
+        return count == 0 ? 0 : sum * n / segments;
+    }
+
+private:
+    int64_t count = 0; // bits
+    int k = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+    std::atomic<int64_t> stored{0};
+    std::atomic<int64_t> ones{0};
+};
+
+inline std::ostream& operator<<(std::ostream& o, const BitStates& s)
+{
+    return o << "stored states: " << s.size()
+             << ", omission probability: " << s.omissionProbability()
+             << ", expected omitted states: " << s.expectedOmissions();
+}
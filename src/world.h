@@ -0,0 +1,84 @@
+/*
+ * Copyright 2013-2016 Grigory Demchenko (aka gridem)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define WLOG(D_msg)         JLOG("WORLD: " << D_msg)
+
+/*
+ * The world is the set of per thread singletons: nodes, queues, handlers,
+ * emulator, stats and context. Blueprint records the steps to create
+ * the world thus any worker thread is able to build its own copy.
+ */
+struct Blueprint
+{
+    void add(Handler step)
+    {
+        steps.push_back(std::move(step));
+    }
+
+    void build() const
+    {
+        for (auto&& step: steps)
+            step();
+    }
+
+private:
+    std::vector<Handler> steps;
+};
+
+using Work = std::function<void(int worker)>;
+
+struct Workers
+{
+    // runs the work on the worker threads, each one owns the world
+    // built using the config and blueprint of the calling thread
+    void run(int count, const Work& work)
+    {
+        if (count <= 1)
+        {
+            work(0);
+            return;
+        }
+        Config conf = *config;
+        Blueprint print = *blueprint;
+        std::vector<std::exception_ptr> errors(count);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < count; ++ i)
+        {
+            threads.emplace_back([&, i] {
+                try
+                {
+                    *config = conf;
+                    print.build();
+                    WLOG("worker started: " << i);
+                    work(i);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto&& t: threads)
+            t.join();
+        for (auto&& e: errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+private:
+    An<Config> config;
+    An<Blueprint> blueprint;
+};